@@ -0,0 +1,145 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include "JournalReader.h"
+
+// Constructor
+JournalReader::JournalReader() :
+	fd(-1),
+	data(nullptr),
+	size(0),
+	records(0),
+	examined(0)
+{
+}
+
+// Destructor
+JournalReader::~JournalReader()
+{
+	Close();
+}
+
+// This opens a journal.
+// Returns an error message or an empty string on success.
+std::string JournalReader::Open(const std::string& filename)
+{
+	Close();
+	fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		return "Unable to open " + filename + ": " + strerror(errno);
+
+	struct stat info;
+	if((fstat(fd, &info) != 0) || (static_cast<std::size_t>(info.st_size) < sizeof(JournalFileHeader)))
+	{
+		Close();
+		return "Unable to read " + filename + ": not a journal.";
+	}
+
+	size = static_cast<std::size_t>(info.st_size);
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if(mapping == MAP_FAILED)
+	{
+		std::string error = "Unable to map " + filename + ": " + strerror(errno);
+		size = 0;
+		Close();
+		return error;
+	}
+	data = static_cast<const unsigned char*>(mapping);
+
+	const JournalFileHeader* header = reinterpret_cast<const JournalFileHeader*>(data);
+	if((memcmp(header->magic, "KJNL", 4) != 0) || (header->version != JournalFormat::VERSION) ||
+	   (header->recordsize != sizeof(JournalRecord)) || (header->indexinterval != JournalFormat::INDEX_INTERVAL))
+	{
+		Close();
+		return "Unable to read " + filename + ": not a journal.";
+	}
+
+	// An incomplete record at the end is being written or was left by an interruption
+	records = (size - sizeof(JournalFileHeader)) / sizeof(JournalRecord);
+	return std::string();
+}
+
+// This closes the journal
+void JournalReader::Close()
+{
+	if(data != nullptr)
+		munmap(const_cast<unsigned char*>(data), size);
+	if(fd >= 0)
+		close(fd);
+	fd = -1;
+	data = nullptr;
+	size = 0;
+	records = 0;
+}
+
+// This finds all events in the specified time range and invokes the callback for each of them.
+// When addresslength is not 0, only events which begin with the first addresslength
+// symbols of the packed address are found.
+void JournalReader::Query(uint64 begin, uint64 end, uint64 address, uint addresslength, std::function<void(const JournalRecord&)> callback)
+{
+	examined = 0;
+	if(addresslength > JournalFormat::ADDRESS_SYMBOLS)
+		addresslength = JournalFormat::ADDRESS_SYMBOLS;
+	uint64 addressmask = (1ULL << (addresslength * 2)) - 1;
+	address &= addressmask;
+
+	// Only a complete address can be looked up in the bloom filters
+	uint64 bloom = (addresslength == JournalFormat::ADDRESS_SYMBOLS) ? JournalFormat::GetAddressBloom(address) : 0;
+
+	// Find the first span which ends at or after the beginning of the range
+	uint64 low = 0;
+	uint64 high = GetSpanCount();
+	while(low < high)
+	{
+		uint64 mid = low + (high - low) / 2;
+		examined++;
+		if(GetIndex(mid).symbols[0] < begin)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	// Go through the spans until the end of the range
+	uint64 r = low * (JournalFormat::INDEX_INTERVAL + 1);
+	while(r < records)
+	{
+		uint64 last = std::min(r + JournalFormat::INDEX_INTERVAL, records);
+		if(last < records)
+		{
+			// This span is complete, so its index tells us if we need to look at it
+			const JournalRecord& index = GetIndex(r / (JournalFormat::INDEX_INTERVAL + 1));
+			examined++;
+			if(index.time >= end)
+				return;
+
+			if((bloom != 0) && ((index.symbols[1] & bloom) != bloom))
+			{
+				r = last + 1;
+				continue;
+			}
+		}
+
+		for(; r < last; r++)
+		{
+			const JournalRecord& record = GetRecord(r);
+			examined++;
+			if(record.type != JournalFormat::EVENT_RECORD)
+				continue;
+			if(record.time >= end)
+				return;
+			if((record.time >= begin) && ((record.symbols[0] & addressmask) == address))
+				callback(record);
+		}
+
+		// Skip the index record
+		r++;
+	}
+}
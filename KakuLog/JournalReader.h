@@ -0,0 +1,64 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <functional>
+#include "../KakuNu/Tools.h"
+#include "../KakuNu/JournalFormat.h"
+
+/*
+	This reads an event journal (see JournalFormat.h) by mapping it into memory.
+	Queries find their start with a binary search over the index records and skip
+	spans of events that cannot contain the wanted address.
+*/
+class JournalReader
+{
+private:
+
+	// The mapped file
+	int fd;
+	const unsigned char* data;
+	std::size_t size;
+
+	// Number of records in the journal
+	uint64 records;
+
+	// Number of records looked at by the last query
+	uint64 examined;
+
+	// This returns a record
+	const JournalRecord& GetRecord(uint64 r) const
+	{
+		return *reinterpret_cast<const JournalRecord*>(data + sizeof(JournalFileHeader) + r * sizeof(JournalRecord));
+	}
+
+	// This returns the number of spans that are complete with an index record
+	uint64 GetSpanCount() const { return records / (JournalFormat::INDEX_INTERVAL + 1); }
+
+	// This returns the index record of a span
+	const JournalRecord& GetIndex(uint64 span) const { return GetRecord(span * (JournalFormat::INDEX_INTERVAL + 1) + JournalFormat::INDEX_INTERVAL); }
+
+public:
+
+	// Constructor / destructor
+	JournalReader();
+	virtual ~JournalReader();
+
+	// This opens a journal.
+	// Returns an error message or an empty string on success.
+	std::string Open(const std::string& filename);
+
+	// This closes the journal
+	void Close();
+
+	// This finds all events in the specified time range and invokes the callback for each of them.
+	// When addresslength is not 0, only events which begin with the first addresslength
+	// symbols of the packed address are found.
+	void Query(uint64 begin, uint64 end, uint64 address, uint addresslength, std::function<void(const JournalRecord&)> callback);
+
+	// Getters
+	uint64 GetRecordCount() const { return records; }
+	uint64 GetExaminedCount() const { return examined; }
+};
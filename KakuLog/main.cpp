@@ -0,0 +1,180 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <string.h>
+#include <time.h>
+#include "../KakuNu/Tools.h"
+#include "../KakuNu/KakuMessage.h"
+#include "JournalReader.h"
+
+// ccxopts raises some warnings (and rightfully so) about integer conversion
+// but instead of messing with the source code I chose to silence these warnings.
+// TODO: Update this source code when the author has a proper fix.
+// https://github.com/jarro2783/cxxopts
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+#include "../KakuNu/cxxopts.hpp"
+#pragma GCC diagnostic pop
+
+// This lists the available options on the command line and parses the given options.
+// Using the ParseResult we can easily determine what options were specified.
+cxxopts::ParseResult ParseCommandLineOptions(int& argc, char**& argv)
+{
+	try
+	{
+		// List the available options
+		cxxopts::Options options("kakulog", "KakuLog: KlikAanKlikUit event journal query tool");
+		options
+			.add_options()
+			("help", "Shows information about the command line options.")
+			("journal", "Journal file written by kakunu --journal", cxxopts::value<std::string>())
+			("from", "Only show events from this time (YYYY-MM-DD [HH:MM[:SS]] or seconds since 1970)", cxxopts::value<std::string>())
+			("to", "Only show events before this time (YYYY-MM-DD [HH:MM[:SS]] or seconds since 1970)", cxxopts::value<std::string>())
+			("address", "Only show events which begin with this code (the address is the first 26 symbols)", cxxopts::value<std::string>())
+			("count", "Only show the number of events found");
+		options.parse_positional("journal");
+		options.custom_help("journal [options...]");
+
+		// Parse the arguments with these options
+		cxxopts::ParseResult cmdargs = options.parse(argc, argv);
+
+		// If the user is just asking for help,
+		// output the available command line options...
+		if(!cmdargs.count("journal") || cmdargs.count("help"))
+		{
+			std::cout << options.help() << std::endl;
+			std::cout << "Example:" << std::endl;
+			std::cout << "   kakulog events.kjnl --from \"2019-06-01 18:00\" --address 11010101101011100010110000" << std::endl;
+			exit(0);
+		}
+
+		return cmdargs;
+	}
+	catch(const cxxopts::OptionException& e)
+	{
+		std::cout << "Error parsing options: " << e.what() << std::endl;
+		exit(1);
+	}
+}
+
+// This parses a local time or a number of seconds since 1970 into microseconds since 1970.
+// Returns False when the time is invalid.
+bool ParseTime(const std::string& str, uint64& microseconds)
+{
+	const char* formats[] = { "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%d" };
+	for(const char* format : formats)
+	{
+		struct tm local;
+		memset(&local, 0, sizeof(local));
+		const char* end = strptime(str.c_str(), format, &local);
+		if((end != nullptr) && (*end == '\0'))
+		{
+			local.tm_isdst = -1;
+			time_t seconds = mktime(&local);
+			if(seconds < 0)
+				return false;
+			microseconds = static_cast<uint64>(seconds) * 1000000;
+			return true;
+		}
+	}
+
+	char* end = nullptr;
+	double seconds = strtod(str.c_str(), &end);
+	if((end == str.c_str()) || (*end != '\0') || (seconds < 0.0))
+		return false;
+	microseconds = static_cast<uint64>(seconds * 1000000.0);
+	return true;
+}
+
+// This parses a code of symbols (as output by kakunu) into packed symbols.
+// Only the first word of symbols is kept, which includes the address.
+// Returns False when the code is invalid.
+bool ParseCode(const std::string& str, uint64& symbols, uint& length)
+{
+	symbols = 0;
+	length = 0;
+	for(char c : str)
+	{
+		if((c < '0') || (c > '3'))
+			return false;
+		if(length < KakuMessage::SYMBOLS_PER_WORD)
+			symbols |= static_cast<uint64>(c - '0') << (length++ * 2);
+	}
+	return true;
+}
+
+// This outputs an event to std out
+void OutputEvent(const JournalRecord& record)
+{
+	time_t seconds = static_cast<time_t>(record.time / 1000000);
+	struct tm local;
+	localtime_r(&seconds, &local);
+	char timestr[32];
+	strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S", &local);
+
+	KakuMessage msg;
+	msg.symbols[0] = record.symbols[0];
+	msg.symbols[1] = record.symbols[1];
+	msg.length = record.length;
+	msg.protocol = static_cast<KakuProtocol>(record.protocol);
+	msg.corrected = ((record.flags & JournalFormat::CORRECTED_FLAG) != 0);
+
+	std::cout << timestr << "." << std::setw(6) << std::setfill('0') << (record.time % 1000000) << std::setfill(' ')
+		<< " " << msg.ToLabeledString() << " pin " << static_cast<uint>(record.pin)
+		<< ", " << record.repeats << "x, " << static_cast<uint>(record.quality) << "%" << std::endl;
+}
+
+// Main program entry
+int main(int argc, char* argv[])
+{
+	// Parse command line options
+	char** nargv = argv;
+	cxxopts::ParseResult cmdargs = ParseCommandLineOptions(argc, nargv);
+
+	uint64 begin = 0;
+	uint64 end = std::numeric_limits<uint64>::max();
+	if(cmdargs.count("from") && !ParseTime(cmdargs["from"].as<std::string>(), begin))
+	{
+		std::cout << "Invalid time '" << cmdargs["from"].as<std::string>() << "'." << std::endl;
+		return 1;
+	}
+	if(cmdargs.count("to") && !ParseTime(cmdargs["to"].as<std::string>(), end))
+	{
+		std::cout << "Invalid time '" << cmdargs["to"].as<std::string>() << "'." << std::endl;
+		return 1;
+	}
+
+	uint64 address = 0;
+	uint addresslength = 0;
+	if(cmdargs.count("address") && !ParseCode(cmdargs["address"].as<std::string>(), address, addresslength))
+	{
+		std::cout << "Invalid address '" << cmdargs["address"].as<std::string>() << "'. Use the symbols 0, 1, 2 and 3." << std::endl;
+		return 1;
+	}
+
+	JournalReader reader;
+	std::string error = reader.Open(cmdargs["journal"].as<std::string>());
+	if(error.size() > 0)
+	{
+		std::cout << error << std::endl;
+		return 1;
+	}
+
+	// Find the events
+	bool countonly = (cmdargs.count("count") > 0);
+	uint64 found = 0;
+	reader.Query(begin, end, address, addresslength, [&found, countonly](const JournalRecord& record)
+	{
+		if(!countonly)
+			OutputEvent(record);
+		found++;
+	});
+
+	std::cout << found << " events found, " << reader.GetExaminedCount() << " records examined in a journal of "
+		<< reader.GetRecordCount() << " records" << std::endl;
+	return 0;
+}
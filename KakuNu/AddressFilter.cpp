@@ -0,0 +1,129 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <fstream>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include "AddressFilter.h"
+
+// Constructor
+AddressFilter::AddressFilter() :
+	shift(31),
+	count(0),
+	acceptedcount(0),
+	filteredcount(0)
+{
+	slots.resize(2, FREE_SLOT);
+}
+
+// Destructor
+AddressFilter::~AddressFilter()
+{
+}
+
+// This loads the addresses from a file with one address on every line. Addresses are
+// decimal numbers or 26 binary symbols. Anything after a # is a comment.
+// Returns an error message or an empty string on success.
+std::string AddressFilter::Load(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if(!file.is_open())
+		return "Unable to open " + filename + ": " + strerror(errno);
+
+	std::vector<uint> addresses;
+	std::string line;
+	uint linenumber = 0;
+	while(std::getline(file, line))
+	{
+		linenumber++;
+		std::size_t comment = line.find('#');
+		if(comment != std::string::npos)
+			line.erase(comment);
+		std::size_t first = line.find_first_not_of(" \t\r");
+		if(first == std::string::npos)
+			continue;
+		std::string word = line.substr(first, line.find_last_not_of(" \t\r") + 1 - first);
+
+		uint address = 0;
+		bool valid = true;
+		if(word.size() == KakuMessage::ADDRESS_BITS)
+		{
+			for(char c : word)
+			{
+				valid = valid && ((c == '0') || (c == '1'));
+				address = (address << 1) | static_cast<uint>(c == '1');
+			}
+		}
+		else
+		{
+			char* end = nullptr;
+			unsigned long value = strtoul(word.c_str(), &end, 10);
+			valid = (*end == '\0') && (value < (1UL << KakuMessage::ADDRESS_BITS));
+			address = static_cast<uint>(value);
+		}
+
+		if(!valid)
+			return "Unable to read " + filename + ": invalid address on line " + std::to_string(linenumber) + ".";
+		addresses.push_back(address);
+	}
+
+	// Make the set large enough to keep the probe sequences short
+	std::size_t capacity = 2;
+	shift = 31;
+	while(capacity < (addresses.size() * 2))
+	{
+		capacity *= 2;
+		shift--;
+	}
+	slots.assign(capacity, FREE_SLOT);
+	count = 0;
+	for(uint address : addresses)
+		Add(address);
+
+	return std::string();
+}
+
+// This adds an address to the set
+void AddressFilter::Add(uint address)
+{
+	std::size_t mask = slots.size() - 1;
+	std::size_t index = GetSlot(address);
+	while(slots[index] != FREE_SLOT)
+	{
+		if(slots[index] == address)
+			return;
+		index = (index + 1) & mask;
+	}
+	slots[index] = address;
+	count++;
+}
+
+// This checks if the address is in the set
+bool AddressFilter::Contains(uint address) const
+{
+	std::size_t mask = slots.size() - 1;
+	std::size_t index = GetSlot(address);
+	while(slots[index] != FREE_SLOT)
+	{
+		if(slots[index] == address)
+			return true;
+		index = (index + 1) & mask;
+	}
+	return false;
+}
+
+// This counts and returns if the message should be kept
+bool AddressFilter::Accept(const KakuMessage& msg)
+{
+	KakuFields fields;
+	if(msg.GetFields(fields) && Contains(fields.address))
+	{
+		acceptedcount.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	filteredcount.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
@@ -0,0 +1,61 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include "Tools.h"
+#include "KakuMessage.h"
+
+/*
+	This keeps only the self-learning KAKU messages of a list of addresses.
+	The addresses are kept in a small open addressing hash set, which is built once
+	and only read afterwards, so it can be used by many decoder threads at once.
+*/
+class AddressFilter
+{
+private:
+
+	// Constants
+	// Addresses have 26 bits, so this value can never be an address
+	static constexpr uint FREE_SLOT = 0xFFFFFFFF;
+
+	// The hash set. The capacity is a power of 2 and at least twice the number of addresses.
+	std::vector<uint> slots;
+	uint shift;
+	std::size_t count;
+
+	// Counters
+	std::atomic<uint64> acceptedcount;
+	std::atomic<uint64> filteredcount;
+
+	// This returns the index of the first slot to look at for an address
+	std::size_t GetSlot(uint address) const { return static_cast<std::size_t>((address * 0x9E3779B1U) >> shift); }
+
+	// This adds an address to the set
+	void Add(uint address);
+
+public:
+
+	// Constructor / destructor
+	AddressFilter();
+	virtual ~AddressFilter();
+
+	// This loads the addresses from a file with one address on every line. Addresses are
+	// decimal numbers or 26 binary symbols. Anything after a # is a comment.
+	// Returns an error message or an empty string on success.
+	std::string Load(const std::string& filename);
+
+	// This checks if the address is in the set
+	bool Contains(uint address) const;
+
+	// This counts and returns if the message should be kept
+	bool Accept(const KakuMessage& msg);
+
+	// Getters
+	std::size_t GetCount() const { return count; }
+	uint64 GetAcceptedCount() const { return acceptedcount; }
+	uint64 GetFilteredCount() const { return filteredcount; }
+};
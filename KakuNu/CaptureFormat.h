@@ -0,0 +1,92 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include "Tools.h"
+
+/*
+	Layout of a capture file (.kcap) with the edges seen by an RFReceiver.
+
+	The file begins with a CaptureFileHeader, followed by blocks of edges. Every block begins with
+	a CaptureBlockHeader and can be decoded on its own. The first edge of a block is at the start
+	time of the block. Every edge after it is stored as a varint (7 bits per byte, lowest first) of
+	the microseconds since the previous edge, shifted up by 1, with the level in the lowest bit.
+
+	When the capture is closed, an index with the start time and offset of every block is written,
+	followed by a CaptureTrailer. When the trailer is missing (the recording was interrupted),
+	the index can be rebuilt by walking the block headers.
+*/
+struct CaptureFormat
+{
+	static constexpr uint VERSION = 1;
+	static constexpr uint MAX_BLOCK_EDGES = 4096;
+	static constexpr uint MAX_VARINT_BYTES = 10;
+	static constexpr uint MAX_BLOCK_SIZE = MAX_BLOCK_EDGES * MAX_VARINT_BYTES;
+
+	// This writes a varint and returns the number of bytes written
+	static inline uint WriteVarint(unsigned char* out, uint64 value)
+	{
+		uint count = 0;
+		while(value >= 0x80)
+		{
+			out[count++] = static_cast<unsigned char>(value | 0x80);
+			value >>= 7;
+		}
+		out[count++] = static_cast<unsigned char>(value);
+		return count;
+	}
+
+	// This reads a varint and returns the position after it, or nullptr when it is incomplete
+	static inline const unsigned char* ReadVarint(const unsigned char* p, const unsigned char* end, uint64& value)
+	{
+		value = 0;
+		for(uint shift = 0; (p < end) && (shift < 64); shift += 7)
+		{
+			unsigned char b = *p++;
+			value |= static_cast<uint64>(b & 0x7F) << shift;
+			if((b & 0x80) == 0)
+				return p;
+		}
+		return nullptr;
+	}
+};
+
+// Header at the start of the file
+struct CaptureFileHeader
+{
+	char magic[4];		// "KCAP"
+	uint version;
+	uint64 created;		// Wall clock time at which the capture was made, in microseconds since the epoch
+};
+
+// Header at the start of each block
+struct CaptureBlockHeader
+{
+	char magic[4];		// "KBLK"
+	uint edges;			// Number of edges in the block
+	uint size;			// Number of bytes after this header
+	uint level;			// Level of the first edge
+	uint64 starttime;	// Time of the first edge in microseconds
+};
+
+// An entry in the block index
+struct CaptureIndexEntry
+{
+	uint64 starttime;
+	uint64 offset;
+};
+
+// Trailer at the end of the file
+struct CaptureTrailer
+{
+	uint64 indexoffset;
+	uint64 blocks;
+	char magic[4];		// "KIDX"
+	uint reserved;
+};
+
+static_assert(sizeof(CaptureFileHeader) == 16, "Unexpected capture file header size");
+static_assert(sizeof(CaptureBlockHeader) == 24, "Unexpected capture block header size");
+static_assert(sizeof(CaptureIndexEntry) == 16, "Unexpected capture index entry size");
+static_assert(sizeof(CaptureTrailer) == 24, "Unexpected capture trailer size");
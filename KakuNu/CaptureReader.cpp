@@ -0,0 +1,164 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include "CaptureReader.h"
+
+// Constructor
+CaptureReader::CaptureReader() :
+	fd(-1),
+	filesize(0)
+{
+}
+
+// Destructor
+CaptureReader::~CaptureReader()
+{
+	Close();
+}
+
+// This opens a capture file and reads its index.
+// Returns an error message or an empty string on success.
+std::string CaptureReader::Open(const std::string& filename)
+{
+	Close();
+	fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		return "Unable to open " + filename + ": " + strerror(errno);
+
+	struct stat info;
+	CaptureFileHeader header;
+	if((fstat(fd, &info) != 0) ||
+	   (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) ||
+	   (memcmp(header.magic, "KCAP", 4) != 0) || (header.version != CaptureFormat::VERSION))
+	{
+		Close();
+		return "Unable to read " + filename + ": not a capture file.";
+	}
+	filesize = static_cast<uint64>(info.st_size);
+
+	// Read the index from the end of the file
+	CaptureTrailer trailer;
+	index.clear();
+	if((filesize >= (sizeof(header) + sizeof(trailer))) &&
+	   (pread(fd, &trailer, sizeof(trailer), static_cast<off_t>(filesize - sizeof(trailer))) == static_cast<ssize_t>(sizeof(trailer))) &&
+	   (memcmp(trailer.magic, "KIDX", 4) == 0) &&
+	   ((trailer.indexoffset + trailer.blocks * sizeof(CaptureIndexEntry) + sizeof(trailer)) == filesize))
+	{
+		index.resize(trailer.blocks);
+		std::size_t indexsize = index.size() * sizeof(CaptureIndexEntry);
+		if(pread(fd, index.data(), indexsize, static_cast<off_t>(trailer.indexoffset)) == static_cast<ssize_t>(indexsize))
+		{
+			filesize = trailer.indexoffset;
+			return std::string();
+		}
+	}
+
+	// The recording was interrupted before the index was written
+	BuildIndex();
+	return std::string();
+}
+
+// This rebuilds the index by walking the block headers.
+// An incomplete block at the end of the file is left out.
+void CaptureReader::BuildIndex()
+{
+	index.clear();
+	uint64 offset = sizeof(CaptureFileHeader);
+	CaptureBlockHeader block;
+	while((offset + sizeof(block)) <= filesize)
+	{
+		if((pread(fd, &block, sizeof(block), static_cast<off_t>(offset)) != static_cast<ssize_t>(sizeof(block))) ||
+		   (memcmp(block.magic, "KBLK", 4) != 0) || ((offset + sizeof(block) + block.size) > filesize))
+			break;
+
+		CaptureIndexEntry entry;
+		entry.starttime = block.starttime;
+		entry.offset = offset;
+		index.push_back(entry);
+		offset += sizeof(block) + block.size;
+	}
+	filesize = offset;
+}
+
+// This closes the file
+void CaptureReader::Close()
+{
+	if(fd >= 0)
+		close(fd);
+	fd = -1;
+	filesize = 0;
+	index.clear();
+}
+
+// This returns the index of the block that contains the specified time
+std::size_t CaptureReader::FindBlock(uint64 time) const
+{
+	// Find the first block that begins after the time. The block before it contains the time.
+	std::vector<CaptureIndexEntry>::const_iterator it = std::upper_bound(index.begin(), index.end(), time,
+		[](uint64 t, const CaptureIndexEntry& entry) { return t < entry.starttime; });
+	return (it == index.begin()) ? 0 : static_cast<std::size_t>(it - index.begin()) - 1;
+}
+
+// This gives the edges to the receiver that are needed to receive all messages that begin
+// in the specified time range. Because messages can cross the boundary of a block, this
+// also reads the block before and the block after the range.
+void CaptureReader::ReadRange(uint64 begin, uint64 end, RFReceiver& receiver)
+{
+	if(index.size() == 0)
+		return;
+
+	std::size_t first = FindBlock(begin);
+	std::size_t last = FindBlock((end > 0) ? (end - 1) : 0);
+	if(first > 0)
+		first--;
+	if((last + 1) < index.size())
+		last++;
+
+	std::vector<unsigned char> payload(CaptureFormat::MAX_BLOCK_SIZE);
+	std::vector<RFReceiver::Edge> edges;
+	edges.reserve(CaptureFormat::MAX_BLOCK_EDGES);
+	uint64 lasttime = 0;
+	for(std::size_t b = first; b <= last; b++)
+		lasttime = ReadBlock(b, payload, edges, receiver);
+
+	// Complete the last message
+	receiver.Flush(lasttime + MAX_PULSE_US);
+}
+
+// This decodes a block and gives its edges to the receiver.
+// Returns the time of the last edge in the block.
+uint64 CaptureReader::ReadBlock(std::size_t b, std::vector<unsigned char>& payload, std::vector<RFReceiver::Edge>& edges, RFReceiver& receiver)
+{
+	CaptureBlockHeader block;
+	off_t offset = static_cast<off_t>(index[b].offset);
+	if((pread(fd, &block, sizeof(block), offset) != static_cast<ssize_t>(sizeof(block))) ||
+	   (block.size > payload.size()) ||
+	   (pread(fd, payload.data(), block.size, offset + static_cast<off_t>(sizeof(block))) != static_cast<ssize_t>(block.size)))
+		return index[b].starttime;
+
+	RFReceiver::Edge edge;
+	edge.time = block.starttime;
+	edge.level = block.level;
+	edges.clear();
+	edges.push_back(edge);
+
+	const unsigned char* p = payload.data();
+	const unsigned char* end = p + block.size;
+	uint64 value;
+	while((p < end) && ((p = CaptureFormat::ReadVarint(p, end, value)) != nullptr))
+	{
+		edge.time += value >> 1;
+		edge.level = static_cast<uint>(value & 1);
+		edges.push_back(edge);
+	}
+
+	receiver.ProcessEdges(edges.data(), edges.size());
+	return edge.time;
+}
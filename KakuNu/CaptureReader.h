@@ -0,0 +1,59 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include "Tools.h"
+#include "CaptureFormat.h"
+#include "RFReceiver.h"
+
+/*
+	This reads a capture file (see CaptureFormat.h) and gives the edges to an RFReceiver.
+	With the block index, a time range can be found with a binary search and every
+	block can be decoded on its own, so that ranges can be decoded in parallel.
+*/
+class CaptureReader
+{
+private:
+
+	// The file we read from
+	int fd;
+	uint64 filesize;
+
+	// Start time and offset of every block
+	std::vector<CaptureIndexEntry> index;
+
+	// This rebuilds the index by walking the block headers
+	void BuildIndex();
+
+	// This decodes a block and gives its edges to the receiver.
+	// Returns the time of the last edge in the block.
+	uint64 ReadBlock(std::size_t b, std::vector<unsigned char>& payload, std::vector<RFReceiver::Edge>& edges, RFReceiver& receiver);
+
+public:
+
+	// Constructor / destructor
+	CaptureReader();
+	virtual ~CaptureReader();
+
+	// This opens a capture file and reads its index.
+	// Returns an error message or an empty string on success.
+	std::string Open(const std::string& filename);
+
+	// This closes the file
+	void Close();
+
+	// This returns the index of the block that contains the specified time
+	std::size_t FindBlock(uint64 time) const;
+
+	// This gives the edges to the receiver that are needed to receive all messages that begin
+	// in the specified time range. Because messages can cross the boundary of a block, this
+	// also reads the block before and the block after the range.
+	void ReadRange(uint64 begin, uint64 end, RFReceiver& receiver);
+
+	// Getters
+	std::size_t GetBlockCount() const { return index.size(); }
+	uint64 GetBlockTime(std::size_t b) const { return index[b].starttime; }
+};
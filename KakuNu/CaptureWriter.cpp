@@ -0,0 +1,106 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+#include "CaptureWriter.h"
+
+// Constructor
+CaptureWriter::CaptureWriter() :
+	offset(0),
+	block(),
+	lasttime(0)
+{
+	payload.resize(CaptureFormat::MAX_BLOCK_SIZE);
+}
+
+// Destructor
+CaptureWriter::~CaptureWriter()
+{
+	Close();
+}
+
+// This creates the file and writes the header.
+// Returns an error message or an empty string on success.
+std::string CaptureWriter::Open(const std::string& filename)
+{
+	file.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+	if(!file.is_open())
+		return "Unable to create " + filename + ": " + strerror(errno);
+
+	CaptureFileHeader header;
+	memcpy(header.magic, "KCAP", 4);
+	header.version = CaptureFormat::VERSION;
+	header.created = static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count());
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	offset = sizeof(header);
+
+	memcpy(block.magic, "KBLK", 4);
+	block.edges = 0;
+	block.size = 0;
+	index.clear();
+	return std::string();
+}
+
+// This adds an edge to the capture
+void CaptureWriter::AddEdge(const RFReceiver::Edge& edge)
+{
+	if(!file.is_open())
+		return;
+
+	if(block.edges == 0)
+	{
+		// The first edge is in the block header
+		block.starttime = edge.time;
+		block.level = edge.level;
+	}
+	else
+	{
+		uint64 value = ((edge.time - lasttime) << 1) | (edge.level & 1);
+		block.size += CaptureFormat::WriteVarint(payload.data() + block.size, value);
+	}
+
+	lasttime = edge.time;
+	if(++block.edges == CaptureFormat::MAX_BLOCK_EDGES)
+		WriteBlock();
+}
+
+// This writes the block being collected
+void CaptureWriter::WriteBlock()
+{
+	if(block.edges == 0)
+		return;
+
+	CaptureIndexEntry entry;
+	entry.starttime = block.starttime;
+	entry.offset = offset;
+	index.push_back(entry);
+
+	file.write(reinterpret_cast<const char*>(&block), sizeof(block));
+	file.write(reinterpret_cast<const char*>(payload.data()), block.size);
+	offset += sizeof(block) + block.size;
+
+	block.edges = 0;
+	block.size = 0;
+}
+
+// This writes the last block and the index, and closes the file
+void CaptureWriter::Close()
+{
+	if(!file.is_open())
+		return;
+
+	WriteBlock();
+
+	CaptureTrailer trailer;
+	trailer.indexoffset = offset;
+	trailer.blocks = index.size();
+	memcpy(trailer.magic, "KIDX", 4);
+	trailer.reserved = 0;
+	file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(CaptureIndexEntry)));
+	file.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+	file.close();
+}
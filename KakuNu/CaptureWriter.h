@@ -0,0 +1,54 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include "Tools.h"
+#include "CaptureFormat.h"
+#include "RFReceiver.h"
+
+/*
+	This writes the edges seen by an RFReceiver to a capture file (see CaptureFormat.h).
+	Edges are collected in a block and the block is written when it is full.
+*/
+class CaptureWriter
+{
+private:
+
+	// The file we write to
+	std::ofstream file;
+	uint64 offset;
+
+	// The block being collected
+	CaptureBlockHeader block;
+	std::vector<unsigned char> payload;
+	uint64 lasttime;
+
+	// Start time and offset of every block written
+	std::vector<CaptureIndexEntry> index;
+
+	// This writes the block being collected
+	void WriteBlock();
+
+public:
+
+	// Constructor / destructor
+	CaptureWriter();
+	virtual ~CaptureWriter();
+
+	// This creates the file and writes the header.
+	// Returns an error message or an empty string on success.
+	std::string Open(const std::string& filename);
+
+	// This adds an edge to the capture
+	void AddEdge(const RFReceiver::Edge& edge);
+
+	// This writes the last block and the index, and closes the file
+	void Close();
+
+	// Getters
+	uint64 GetSize() { return offset; }
+};
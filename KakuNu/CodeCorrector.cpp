@@ -0,0 +1,88 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include "CodeCorrector.h"
+
+// An 'off' or another unit of a known code is a real command, which must not be corrected.
+// The code is address 0b1101..., group 0, on, unit 1 and the messages differ from it in one symbol.
+namespace
+{
+	constexpr KakuMessage MakeCode(uint64 symbols)
+	{
+		KakuMessage msg;
+		msg.symbols[0] = symbols;
+		msg.length = KakuMessage::FIELDS_SYMBOLS;
+		return msg;
+	}
+	constexpr uint64 KNOWN_ON = 0x0000000000000045ULL | (1ULL << (KakuMessage::STATE_SYMBOL * 2)) | (1ULL << 62);
+	constexpr uint64 STATE_OFF = KNOWN_ON & ~KakuMessage::STATE_MASK;
+	constexpr uint64 OTHER_UNIT = KNOWN_ON ^ (1ULL << 60);
+	constexpr uint64 OTHER_ADDRESS = KNOWN_ON ^ (1ULL << 10);
+	static_assert(CodeCorrector::GetDistance(MakeCode(KNOWN_ON), MakeCode(STATE_OFF)) == 0, "The state must not be corrected");
+	static_assert(CodeCorrector::GetDistance(MakeCode(KNOWN_ON), MakeCode(OTHER_UNIT)) == 0, "The unit must not be corrected");
+	static_assert(CodeCorrector::GetDistance(MakeCode(KNOWN_ON), MakeCode(OTHER_ADDRESS)) == 1, "The address must be corrected");
+}
+
+// Constructor
+CodeCorrector::CodeCorrector() :
+	maxdistance(0),
+	correctedcount(0),
+	ambiguouscount(0)
+{
+}
+
+// Destructor
+CodeCorrector::~CodeCorrector()
+{
+}
+
+// This changes the address and group of the message into those of the nearest known code,
+// when it is within the maximum distance. When two codes are equally near, the message
+// is left alone. Returns True when the message was corrected.
+bool CodeCorrector::Correct(KakuMessage& msg)
+{
+	if(!HasAddress(msg))
+		return false;
+
+	// Find the nearest code and whether there is another one as near
+	const KakuMessage* nearest = nullptr;
+	uint nearestdistance = maxdistance + 1;
+	bool ambiguous = false;
+	for(const KakuMessage& code : codes)
+	{
+		if(!HasAddress(code))
+			continue;
+
+		uint distance = GetDistance(code, msg);
+		if(distance == 0)
+			return false;
+
+		if(distance < nearestdistance)
+		{
+			nearest = &code;
+			nearestdistance = distance;
+			ambiguous = false;
+		}
+		else if((distance == nearestdistance) && (GetDistance(code, *nearest) != 0))
+		{
+			// Codes of the same remote have the same address, those are not ambiguous
+			ambiguous = true;
+		}
+	}
+
+	if(nearest == nullptr)
+		return false;
+
+	if(ambiguous)
+	{
+		ambiguouscount.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Only the address and group are taken from the code, the command is kept as received
+	msg.symbols[0] = (msg.symbols[0] & ~IDENTITY_MASK) | (nearest->symbols[0] & IDENTITY_MASK);
+	msg.corrected = true;
+	correctedcount.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
@@ -0,0 +1,69 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <vector>
+#include <atomic>
+#include "Tools.h"
+#include "KakuMessage.h"
+
+/*
+	This corrects self-learning messages of which the address differs in a few symbols from a
+	known code. Such a message is almost always a corrupted transmission from that remote.
+	Only the address and group symbols are compared and corrected. The state, unit and dim level
+	are what the user pressed, so those are kept as received: an 'off' of a known 'on' code is
+	a real command and not a corruption. The number of different symbols is found with an XOR
+	of the packed symbols and a popcount of the symbols that have any bit set.
+	The codes are only read after they are set, so a corrector can be used by many decoder threads at once.
+*/
+class CodeCorrector
+{
+private:
+
+	// The address and group symbols, which are the first symbols of a message
+	static constexpr uint IDENTITY_SYMBOLS = KakuMessage::ADDRESS_BITS + 1;
+	static constexpr uint64 IDENTITY_MASK = (1ULL << (IDENTITY_SYMBOLS * 2)) - 1;
+
+	// The known codes
+	std::vector<KakuMessage> codes;
+
+	// Largest number of different symbols that is corrected
+	uint maxdistance;
+
+	// Counters
+	std::atomic<uint64> correctedcount;
+	std::atomic<uint64> ambiguouscount;
+
+public:
+
+	// Constructor / destructor
+	CodeCorrector();
+	virtual ~CodeCorrector();
+
+	// This returns the number of address and group symbols in which two messages differ
+	static constexpr uint GetDistance(const KakuMessage& a, const KakuMessage& b)
+	{
+		uint64 x = (a.symbols[0] ^ b.symbols[0]) & IDENTITY_MASK;
+		return static_cast<uint>(__builtin_popcountll((x | (x >> 1)) & KakuMessage::LOW_BITS));
+	}
+
+	// Returns True when a message has the layout of a self-learning message with an address
+	static constexpr bool HasAddress(const KakuMessage& msg)
+	{
+		return (msg.protocol == KakuProtocol::SelfLearning) &&
+			((msg.length == KakuMessage::FIELDS_SYMBOLS) || (msg.length == KakuMessage::DIM_FIELDS_SYMBOLS));
+	}
+
+	// This changes the address and group of the message into those of the nearest known code,
+	// when it is within the maximum distance. When two codes are equally near, the message
+	// is left alone. Returns True when the message was corrected.
+	bool Correct(KakuMessage& msg);
+
+	// Getters / setters
+	void SetCodes(const std::vector<KakuMessage>& knowncodes) { codes = knowncodes; }
+	void SetMaxDistance(uint symbols) { maxdistance = symbols; }
+	uint GetMaxDistance() const { return maxdistance; }
+	uint64 GetCorrectedCount() const { return correctedcount; }
+	uint64 GetAmbiguousCount() const { return ambiguouscount; }
+};
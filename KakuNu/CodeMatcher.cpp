@@ -0,0 +1,158 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <fstream>
+#include <errno.h>
+#include <string.h>
+#include "CodeMatcher.h"
+#include "../KakuSend/KakuEncoder.h"
+
+// Constructor
+CodeMatcher::CodeMatcher() :
+	groups(0),
+	numtimes(0)
+{
+}
+
+// Destructor
+CodeMatcher::~CodeMatcher()
+{
+}
+
+// This loads the codes from a file with one code on every line. Codes are self-learning
+// bitcodes of the symbols 0, 1, 2 and 3. Anything after a # is a comment.
+// Returns an error message or an empty string on success.
+std::string CodeMatcher::Load(const std::string& filename)
+{
+	std::ifstream file(filename);
+	if(!file.is_open())
+		return "Unable to open " + filename + ": " + strerror(errno);
+
+	std::vector<std::string> bitcodes;
+	std::string line;
+	uint linenumber = 0;
+	uint longest = 0;
+	while(std::getline(file, line))
+	{
+		linenumber++;
+		std::size_t comment = line.find('#');
+		if(comment != std::string::npos)
+			line.erase(comment);
+		std::size_t first = line.find_first_not_of(" \t\r");
+		if(first == std::string::npos)
+			continue;
+		std::string word = line.substr(first, line.find_last_not_of(" \t\r") + 1 - first);
+
+		bool valid = (word.size() <= MAX_SYMBOLS);
+		for(char c : word)
+			valid = valid && (c >= '0') && (c <= '3');
+		if(!valid)
+			return "Unable to read " + filename + ": invalid code on line " + std::to_string(linenumber) + ".";
+
+		bitcodes.push_back(word);
+		if(word.size() > longest)
+			longest = static_cast<uint>(word.size());
+	}
+
+	// Make room for all codes. The last timings of a code are the end marker, which we don't wait for.
+	codes.clear();
+	groups = static_cast<uint>((bitcodes.size() + LANES - 1) / LANES);
+	numtimes = KakuEncoder::GetMessageTimes(longest) - 2;
+	nominal.assign(numtimes * groups, Lanes { });
+	tolerance.assign(numtimes * groups, Lanes { } + static_cast<uint16>(0xFFFF));
+	finish.assign(numtimes * groups, Mask { });
+	used.assign(groups, Mask { });
+	for(const std::string& bits : bitcodes)
+		Add(bits);
+
+	return std::string();
+}
+
+// This adds a code to the templates
+void CodeMatcher::Add(const std::string& bits)
+{
+	uint16 times[KakuEncoder::MAX_TIMES];
+	uint count = 0;
+	KakuEncoder::Encode(bits.c_str(), static_cast<uint>(bits.size()), times, KakuEncoder::MAX_TIMES, count);
+
+	uint group = static_cast<uint>(codes.size() / LANES);
+	uint lane = static_cast<uint>(codes.size() % LANES);
+	uint last = count - 3;
+	for(uint i = 0; i <= last; i++)
+	{
+		nominal[i * groups + group][lane] = times[i];
+		tolerance[i * groups + group][lane] = static_cast<uint16>(times[i] * TOLERANCE / 100);
+	}
+	finish[last * groups + group][lane] = -1;
+	used[group][lane] = -1;
+
+	KakuMessage msg;
+	for(uint i = 0; i < bits.size(); i++)
+		msg.symbols[i / KakuMessage::SYMBOLS_PER_WORD] |= static_cast<uint64>(bits[i] - '0') << ((i % KakuMessage::SYMBOLS_PER_WORD) * 2);
+	msg.length = static_cast<uint>(bits.size());
+	msg.quality = 100;
+	codes.push_back(msg);
+}
+
+// This compares the timing at the specified index of a message with all codes.
+// Returns the index of the code that matches, or -1 when no code has matched (yet).
+int CodeMatcher::Match(State& state, uint index, uint16 time) const
+{
+	// Every code can match at the start of a message
+	if(index == 0)
+	{
+		state.alive = used;
+		state.active = (groups > 0);
+	}
+
+	if(!state.active || (index >= numtimes))
+	{
+		state.active = false;
+		return -1;
+	}
+
+	// Compare the timing with the templates of all groups.
+	// The absolute difference of unsigned timings is the larger minus the smaller.
+	Lanes t = Lanes { } + time;
+	const Lanes* n = &nominal[index * groups];
+	const Lanes* tol = &tolerance[index * groups];
+	const Mask* fin = &finish[index * groups];
+	bool anyalive = false;
+	for(uint g = 0; g < groups; g++)
+	{
+		Lanes difference = (t > n[g]) ? (t - n[g]) : (n[g] - t);
+		Mask alive = state.alive[g] & (difference <= tol[g]);
+		state.alive[g] = alive;
+
+		uint64 words[2];
+		memcpy(words, &alive, sizeof(words));
+		if((words[0] | words[1]) == 0)
+			continue;
+		anyalive = true;
+
+		// Check for codes that end here
+		Mask hits = alive & fin[g];
+		memcpy(words, &hits, sizeof(words));
+		if((words[0] | words[1]) != 0)
+		{
+			for(uint lane = 0; lane < LANES; lane++)
+			{
+				if(hits[lane] != 0)
+				{
+					state.active = false;
+					return static_cast<int>(g * LANES + lane);
+				}
+			}
+		}
+	}
+
+	state.active = anyalive;
+	return -1;
+}
+
+// Returns the number of timings of a whole message of a code, including the end marker
+uint CodeMatcher::GetMessageTimes(uint index) const
+{
+	return KakuEncoder::GetMessageTimes(codes[index].length);
+}
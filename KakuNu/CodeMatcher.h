@@ -0,0 +1,93 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include "Tools.h"
+#include "KakuMessage.h"
+
+/*
+	This recognizes known self-learning codes from their timings as they are received,
+	without decoding. The pulses of every code are made with KakuEncoder and compared with
+	every received timing, for all codes at once. The codes are kept in groups of LANES codes,
+	with a vector of their nominal timings and tolerances for every timing in the message.
+	A code matches as soon as its last data timing is received, before the end marker.
+
+	The templates are only read after loading, so a matcher can be used by many receivers.
+	Every receiver keeps its own State.
+*/
+class CodeMatcher
+{
+public:
+
+	// Number of codes compared at once. The vectors are 128 bits, which the
+	// compiler maps to SSE on x86 and NEON on ARM, or to scalar code elsewhere.
+	static constexpr uint LANES = 8;
+	typedef uint16 Lanes __attribute__((vector_size(LANES * sizeof(uint16))));
+	typedef short Mask __attribute__((vector_size(LANES * sizeof(short))));
+
+	// The progress of matching the message being received
+	struct State
+	{
+		// Codes of which all timings so far were within the tolerance, for every group
+		std::vector<Mask> alive;
+
+		// False when no code can match the message anymore
+		bool active;
+	};
+
+private:
+
+	// Percentage by which a timing may differ from the template
+	static constexpr uint TOLERANCE = 20;
+
+	// Longest code in symbols. Longer messages do not fit in the receiver.
+	static constexpr uint MAX_SYMBOLS = 48;
+
+	// The codes as messages
+	std::vector<KakuMessage> codes;
+
+	// Number of groups of LANES codes and the number of timings of the longest code
+	uint groups;
+	uint numtimes;
+
+	// The templates, for every timing of the message there is a vector for every group.
+	// A vector is at index [time * groups + group].
+	// Beyond the end of a code, the tolerance accepts any timing.
+	std::vector<Lanes> nominal;
+	std::vector<Lanes> tolerance;
+
+	// The codes of which this is the last data timing
+	std::vector<Mask> finish;
+
+	// The codes which are in use in every group
+	std::vector<Mask> used;
+
+	// This adds a code to the templates
+	void Add(const std::string& bits);
+
+public:
+
+	// Constructor / destructor
+	CodeMatcher();
+	virtual ~CodeMatcher();
+
+	// This loads the codes from a file with one code on every line. Codes are self-learning
+	// bitcodes of the symbols 0, 1, 2 and 3. Anything after a # is a comment.
+	// Returns an error message or an empty string on success.
+	std::string Load(const std::string& filename);
+
+	// This compares the timing at the specified index of a message with all codes.
+	// Returns the index of the code that matches, or -1 when no code has matched (yet).
+	int Match(State& state, uint index, uint16 time) const;
+
+	// Getters
+	std::size_t GetCount() const { return codes.size(); }
+	const KakuMessage& GetCode(uint index) const { return codes[index]; }
+	const std::vector<KakuMessage>& GetCodes() const { return codes; }
+
+	// Returns the number of timings of a whole message of a code, including the end marker
+	uint GetMessageTimes(uint index) const;
+};
@@ -0,0 +1,129 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include "DecoderRegistry.h"
+
+// Constructor
+DecoderRegistry::DecoderRegistry() :
+	numprotocols(0),
+	windows(Windows { DEFAULT_MIN_SHORT_US, DEFAULT_MIN_MEDIUM_US, DEFAULT_MIN_LONG_US, DEFAULT_MIN_PAUSE_US })
+{
+	for(uint k = 0; k < NUM_KEYS; k++)
+		dispatch[k] = 0;
+}
+
+// Destructor
+DecoderRegistry::~DecoderRegistry()
+{
+}
+
+// This returns the class of a timing
+DecoderRegistry::PulseClass DecoderRegistry::Classify(uint16 t, const Windows& w)
+{
+	if(t < w.minshort)
+		return Glitch;
+	else if(t < w.minmedium)
+		return Short;
+	else if(t < w.minlong)
+		return Medium;
+	else if(t < w.minpause)
+		return Long;
+	else
+		return Pause;
+}
+
+// This adds a protocol. Protocols added first are tried first.
+void DecoderRegistry::Register(KakuProtocol protocol, const Signature& signature, DecodeFunction decode)
+{
+	if(numprotocols == MAX_PROTOCOLS)
+		return;
+
+	Protocol& p = protocols[numprotocols];
+	p.protocol = protocol;
+	p.signature = signature;
+	p.decode = decode;
+	p.matched = 0;
+	p.decoded = 0;
+
+	// Add the protocol to every combination of classes its signature allows
+	for(uint k = 0; k < NUM_KEYS; k++)
+	{
+		uint f0 = k / (NUM_CLASSES * NUM_CLASSES * NUM_CLASSES);
+		uint f1 = (k / (NUM_CLASSES * NUM_CLASSES)) % NUM_CLASSES;
+		uint l0 = (k / NUM_CLASSES) % NUM_CLASSES;
+		uint l1 = k % NUM_CLASSES;
+		if(((signature.first[0] >> f0) & (signature.first[1] >> f1) & (signature.last[0] >> l0) & (signature.last[1] >> l1) & 1) != 0)
+			dispatch[k] |= 1U << numprotocols;
+	}
+
+	numprotocols++;
+}
+
+// This decodes a message with the first protocol that matches and can decode it.
+// Returns an error message or an empty string on success.
+std::string DecoderRegistry::Decode(const std::vector<uint16>& times, KakuMessage& msg)
+{
+	if(times.size() < 4)
+		return "Message could not be decoded. Insufficient data received.";
+
+	// The windows are taken once for the message
+	const Windows& w = windows.Get();
+	std::size_t n = times.size();
+	uint key = ((Classify(times[0], w) * NUM_CLASSES + Classify(times[1], w)) * NUM_CLASSES
+		+ Classify(times[n - 2], w)) * NUM_CLASSES + Classify(times[n - 1], w);
+	uint candidates = dispatch[key];
+	std::string error = "Message could not be decoded. No protocol matches the signals.";
+	while(candidates != 0)
+	{
+		uint index = static_cast<uint>(__builtin_ctz(candidates));
+		candidates &= candidates - 1;
+
+		Protocol& p = protocols[index];
+		if((n < p.signature.mintimes) || (n > p.signature.maxtimes))
+			continue;
+
+		p.matched.fetch_add(1, std::memory_order_relaxed);
+		msg.protocol = p.protocol;
+		error = p.decode(times, msg);
+		if(error.size() == 0)
+		{
+			p.decoded.fetch_add(1, std::memory_order_relaxed);
+			return error;
+		}
+	}
+
+	return error;
+}
+
+// This changes the windows of the classes (can be called from any thread).
+// Returns an error message or an empty string on success.
+std::string DecoderRegistry::SetWindows(const Windows& w)
+{
+	if((w.minshort >= w.minmedium) || (w.minmedium >= w.minlong) || (w.minlong >= w.minpause))
+		return "The windows of the pulse classes must be in increasing order.";
+
+	windows.Publish(w);
+	return std::string();
+}
+
+// Returns the least number of timings any protocol needs
+uint DecoderRegistry::GetMinTimes() const
+{
+	uint mintimes = 0;
+	for(uint i = 0; i < numprotocols; i++)
+	{
+		if((i == 0) || (protocols[i].signature.mintimes < mintimes))
+			mintimes = protocols[i].signature.mintimes;
+	}
+	return mintimes;
+}
+
+// Returns the counters of all protocols (these can be read from any thread)
+std::vector<DecoderRegistry::Statistics> DecoderRegistry::GetStatistics() const
+{
+	std::vector<Statistics> stats;
+	for(uint i = 0; i < numprotocols; i++)
+		stats.push_back(Statistics { KakuMessage::GetProtocolName(protocols[i].protocol), protocols[i].matched, protocols[i].decoded });
+	return stats;
+}
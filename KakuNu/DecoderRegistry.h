@@ -0,0 +1,142 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <vector>
+#include <string>
+#include <atomic>
+#include <functional>
+#include "Tools.h"
+#include "KakuMessage.h"
+#include "RcuPointer.h"
+
+/*
+	This knows the protocols that can be decoded and gives a message to the decoders of the
+	protocols it may belong to. Every protocol has a signature: the range of the number of
+	timings and the coarse classes of the first two and last two timings. The classes of a
+	message are looked up in a table made when registering, so a message is only given to the
+	decoders whose signature matches, without trying the other protocols.
+*/
+class DecoderRegistry
+{
+public:
+
+	// Coarse classes of timings, used for the signatures
+	enum PulseClass : uint
+	{
+		Glitch = 0,		// Shorter than any protocol uses
+		Short = 1,		// Around 250 to 450 us
+		Medium = 2,		// Around 1 to 1.5 ms
+		Long = 3,		// Around 2.5 ms
+		Pause = 4		// Gaps between messages
+	};
+
+	// The shortest timings of the classes in microseconds. A timing shorter than
+	// minshort is a glitch. These can be changed while decoding, a new set is
+	// published as a whole and taken for the next message.
+	struct Windows
+	{
+		uint minshort;
+		uint minmedium;
+		uint minlong;
+		uint minpause;
+
+		// Comparison, so that publishing the same windows again does nothing
+		bool operator==(const Windows& other) const
+		{
+			return (minshort == other.minshort) && (minmedium == other.minmedium) &&
+				(minlong == other.minlong) && (minpause == other.minpause);
+		}
+	};
+
+	// Mask which allows all pulse classes
+	static constexpr uint ANY_CLASS = 0x1F;
+
+	// Signature of a protocol
+	struct Signature
+	{
+		// Range of the number of timings
+		uint mintimes;
+		uint maxtimes;
+
+		// Masks of the allowed classes of the first two and the last two timings
+		uint first[2];
+		uint last[2];
+	};
+
+	// Function that decodes the timings of a message into the message.
+	// Returns an error message or an empty string on success.
+	typedef std::function<std::string(const std::vector<uint16>& times, KakuMessage& msg)> DecodeFunction;
+
+	// Counters of a protocol
+	struct Statistics
+	{
+		const char* name;
+
+		// Number of messages which matched the signature
+		uint64 matched;
+
+		// Number of messages decoded
+		uint64 decoded;
+	};
+
+private:
+
+	// Constants
+	static constexpr uint MAX_PROTOCOLS = 8;
+	static constexpr uint NUM_CLASSES = 5;
+	static constexpr uint NUM_KEYS = NUM_CLASSES * NUM_CLASSES * NUM_CLASSES * NUM_CLASSES;
+	const uint DEFAULT_MIN_SHORT_US = 100;
+	const uint DEFAULT_MIN_MEDIUM_US = 650;
+	const uint DEFAULT_MIN_LONG_US = 2000;
+	const uint DEFAULT_MIN_PAUSE_US = 5000;
+
+	// A registered protocol
+	struct Protocol
+	{
+		KakuProtocol protocol;
+		Signature signature;
+		DecodeFunction decode;
+		std::atomic<uint64> matched;
+		std::atomic<uint64> decoded;
+	};
+
+	// The registered protocols, in order of priority
+	Protocol protocols[MAX_PROTOCOLS];
+	uint numprotocols;
+
+	// For every combination of the classes of the first two and last two timings,
+	// the bits of the protocols whose signature allows it.
+	uint dispatch[NUM_KEYS];
+
+	// The windows of the classes
+	RcuPointer<Windows> windows;
+
+	// This returns the class of a timing
+	static PulseClass Classify(uint16 t, const Windows& w);
+
+public:
+
+	// Constructor / destructor
+	DecoderRegistry();
+	virtual ~DecoderRegistry();
+
+	// This adds a protocol. Protocols added first are tried first.
+	void Register(KakuProtocol protocol, const Signature& signature, DecodeFunction decode);
+
+	// This decodes a message with the first protocol that matches and can decode it.
+	// Returns an error message or an empty string on success.
+	std::string Decode(const std::vector<uint16>& times, KakuMessage& msg);
+
+	// This changes the windows of the classes (can be called from any thread).
+	// Returns an error message or an empty string on success.
+	std::string SetWindows(const Windows& w);
+	const Windows& GetWindows() const { return windows.Get(); }
+
+	// Returns the least number of timings any protocol needs
+	uint GetMinTimes() const;
+
+	// Returns the counters of all protocols (these can be read from any thread)
+	std::vector<Statistics> GetStatistics() const;
+};
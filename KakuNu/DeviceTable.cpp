@@ -0,0 +1,137 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include "DeviceTable.h"
+
+// Constructor
+DeviceTable::DeviceTable() :
+	count(0),
+	timebase(0),
+	updates(0),
+	ignored(0)
+{
+	slots.resize(INITIAL_CAPACITY, Slot());
+}
+
+// Destructor
+DeviceTable::~DeviceTable()
+{
+}
+
+// This returns the slot for the key, which is either the slot with the key or the free slot where it belongs
+std::size_t DeviceTable::FindSlot(uint64 key) const
+{
+	std::size_t mask = slots.size() - 1;
+	std::size_t index = static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+	while((slots[index].key != 0) && (slots[index].key != key))
+		index = (index + 1) & mask;
+	return index;
+}
+
+// This doubles the capacity of the table
+void DeviceTable::Grow()
+{
+	std::vector<Slot> oldslots(slots.size() * 2, Slot());
+	oldslots.swap(slots);
+	for(const Slot& slot : oldslots)
+	{
+		if(slot.key != 0)
+			slots[FindSlot(slot.key)] = slot;
+	}
+}
+
+// This updates the table with a decoded message. Other messages than self-learning KAKU are ignored.
+void DeviceTable::AddMessage(const KakuMessage& msg)
+{
+	// The address can not be all zeroes, because a key of 0 marks a free slot
+	KakuFields fields;
+	if(!msg.GetFields(fields) || (fields.address == 0))
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ignored++;
+		return;
+	}
+
+	uint64 key = msg.symbols[0] & KEY_MASK;
+	std::lock_guard<std::mutex> lock(mutex);
+	std::size_t index = FindSlot(key);
+	if(slots[index].key == 0)
+	{
+		// New device
+		if(((count + 1) * 10) > (slots.size() * 7))
+		{
+			Grow();
+			index = FindSlot(key);
+		}
+
+		slots[index].key = key;
+		slots[index].device.address = fields.address;
+		slots[index].device.unit = fields.unit;
+		slots[index].device.group = fields.group;
+		slots[index].device.dimlevel = 0;
+		slots[index].device.hits = 0;
+		count++;
+	}
+
+	Device& device = slots[index].device;
+	device.state = fields.state;
+	if(fields.state == State::Dim)
+		device.dimlevel = fields.dimlevel;
+	device.time = timebase + msg.time;
+	device.hits++;
+	updates++;
+}
+
+// This finds a device. Returns False when the device is not known.
+bool DeviceTable::Find(uint address, uint unit, bool group, Device& device) const
+{
+	// Build the key like the packed symbols of a message
+	KakuFields fields;
+	fields.address = address;
+	fields.unit = unit;
+	fields.group = group;
+	KakuMessage msg;
+	msg.SetFields(fields);
+	uint64 key = msg.symbols[0] & KEY_MASK;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const Slot& slot = slots[FindSlot(key)];
+	if(slot.key == 0)
+		return false;
+
+	device = slot.device;
+	return true;
+}
+
+// This invokes the callback for every device
+void DeviceTable::ForEach(std::function<void(const Device&)> callback) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for(const Slot& slot : slots)
+	{
+		if(slot.key != 0)
+			callback(slot.device);
+	}
+}
+
+// Returns the number of devices
+std::size_t DeviceTable::GetCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return count;
+}
+
+// Returns the number of messages used to update the table
+uint64 DeviceTable::GetUpdateCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return updates;
+}
+
+// Returns the number of messages which were not self-learning KAKU messages
+uint64 DeviceTable::GetIgnoredCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return ignored;
+}
@@ -0,0 +1,95 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <vector>
+#include <mutex>
+#include <functional>
+#include "Tools.h"
+#include "KakuMessage.h"
+
+/*
+	This keeps the last known state of every device (address and unit) seen in
+	self-learning KAKU messages, in an open addressing hash table with linear probing.
+	The key is the packed symbols of the message without the state symbol, so it holds
+	the address, group flag and unit. Group commands are kept apart from the units.
+*/
+class DeviceTable
+{
+public:
+
+	// State of a device
+	typedef KakuFields::State State;
+
+	// What we know about a device
+	struct Device
+	{
+		uint address;
+		uint unit;
+		bool group;
+		State state;
+		uint dimlevel;
+
+		// Wall clock time of the last message, in microseconds since the epoch
+		uint64 time;
+
+		// Number of messages received for the device
+		uint64 hits;
+	};
+
+private:
+
+	// Constants
+	static constexpr uint64 KEY_MASK = ~KakuMessage::STATE_MASK;
+	const std::size_t INITIAL_CAPACITY = 256;
+
+	// A slot in the table. The key is 0 when the slot is free,
+	// which is no valid key because the address can not be all zeroes.
+	struct Slot
+	{
+		uint64 key;
+		Device device;
+	};
+
+	// The table. The capacity is always a power of 2 and never more than 70% is used.
+	std::vector<Slot> slots;
+	std::size_t count;
+
+	// Mutex for thread synchronization
+	mutable std::mutex mutex;
+
+	// Added to the time of a message to make it wall clock time
+	uint64 timebase;
+
+	// Counters
+	uint64 updates;
+	uint64 ignored;
+
+	// This returns the slot for the key, which is either the slot with the key or the free slot where it belongs
+	std::size_t FindSlot(uint64 key) const;
+
+	// This doubles the capacity of the table
+	void Grow();
+
+public:
+
+	// Constructor / destructor
+	DeviceTable();
+	virtual ~DeviceTable();
+
+	// This updates the table with a decoded message. Other messages than self-learning KAKU are ignored.
+	void AddMessage(const KakuMessage& msg);
+
+	// This finds a device. Returns False when the device is not known.
+	bool Find(uint address, uint unit, bool group, Device& device) const;
+
+	// This invokes the callback for every device
+	void ForEach(std::function<void(const Device&)> callback) const;
+
+	// Getters / setters
+	void SetTimeBase(uint64 microseconds) { timebase = microseconds; }
+	std::size_t GetCount() const;
+	uint64 GetUpdateCount() const;
+	uint64 GetIgnoredCount() const;
+};
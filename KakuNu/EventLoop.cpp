@@ -0,0 +1,132 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <iostream>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "EventLoop.h"
+
+// Constructor
+EventLoop::EventLoop() :
+	stop(false)
+{
+	epollfd = epoll_create1(EPOLL_CLOEXEC);
+	if(epollfd < 0)
+		std::cout << "Error creating epoll: " << strerror(errno) << std::endl;
+}
+
+// Destructor
+EventLoop::~EventLoop()
+{
+	for(const Watch& w : watches)
+	{
+		if(w.owned && (w.fd >= 0))
+			close(w.fd);
+	}
+
+	if(epollfd >= 0)
+		close(epollfd);
+}
+
+// This calls the handler whenever the file descriptor is readable.
+// Returns an error message or an empty string on success.
+std::string EventLoop::Add(int fd, std::function<void()> handler)
+{
+	watches.push_back({ fd, false, handler });
+
+	epoll_event ev = { };
+	ev.events = EPOLLIN;
+	ev.data.ptr = &watches.back();
+	if(epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+	{
+		watches.pop_back();
+		return std::string("Unable to wait for events: ") + strerror(errno);
+	}
+
+	return std::string();
+}
+
+// This stops calling the handler of a file descriptor
+void EventLoop::Remove(int fd)
+{
+	for(Watch& w : watches)
+	{
+		if(w.fd == fd)
+		{
+			epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, nullptr);
+			if(w.owned)
+				close(fd);
+			w.fd = -1;
+			return;
+		}
+	}
+}
+
+// This calls the handler every interval of milliseconds.
+// Returns an error message or an empty string on success.
+std::string EventLoop::AddTimer(uint interval_ms, std::function<void()> handler)
+{
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if(fd < 0)
+		return std::string("Unable to create timer: ") + strerror(errno);
+
+	itimerspec spec = { };
+	spec.it_interval.tv_sec = interval_ms / 1000;
+	spec.it_interval.tv_nsec = static_cast<long>(interval_ms % 1000) * 1000000;
+	spec.it_value = spec.it_interval;
+	if(timerfd_settime(fd, 0, &spec, nullptr) < 0)
+	{
+		std::string error = std::string("Unable to start timer: ") + strerror(errno);
+		close(fd);
+		return error;
+	}
+
+	// The expirations must be read, or the timer stays readable
+	std::string error = Add(fd, [fd, handler]()
+	{
+		uint64 expirations;
+		if(read(fd, &expirations, sizeof(expirations)) > 0)
+			handler();
+	});
+	if(error.size() > 0)
+	{
+		close(fd);
+		return error;
+	}
+
+	watches.back().owned = true;
+	return std::string();
+}
+
+// This calls the handlers until Stop is called
+void EventLoop::Run()
+{
+	epoll_event events[MAX_EVENTS];
+	stop = false;
+	while(!stop)
+	{
+		int count = epoll_wait(epollfd, events, MAX_EVENTS, -1);
+		if(count < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			std::cout << "Error waiting for events: " << strerror(errno) << std::endl;
+			return;
+		}
+
+		for(int i = 0; (i < count) && !stop; i++)
+		{
+			// Skip a watch which was removed by an earlier handler
+			Watch* w = static_cast<Watch*>(events[i].data.ptr);
+			if(w->fd >= 0)
+				w->handler();
+		}
+
+		watches.remove_if([](const Watch& w) { return w.fd < 0; });
+	}
+}
@@ -0,0 +1,64 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <list>
+#include <functional>
+#include "Tools.h"
+
+/*
+	This waits for file descriptors to become readable with epoll and calls their handlers,
+	all on the thread that runs the loop. Timers are file descriptors as well (timerfd),
+	so the thread only wakes up when there is something to do.
+*/
+class EventLoop final
+{
+private:
+
+	// Maximum number of events taken from epoll at once
+	static constexpr int MAX_EVENTS = 16;
+
+	// A file descriptor we wait for and its handler
+	struct Watch
+	{
+		int fd;
+		bool owned;
+		std::function<void()> handler;
+	};
+
+	// Members. The watches are in a list, so that epoll can point to them.
+	// A removed watch has no file descriptor and is erased after the events of a wait
+	// are handled, because a later event of the same wait may still point to it.
+	int epollfd;
+	std::list<Watch> watches;
+	bool stop;
+
+public:
+
+	// Constructor/destructor
+	EventLoop();
+	~EventLoop();
+
+	// Not copyable, because the file descriptors are owned
+	EventLoop(const EventLoop&) = delete;
+	EventLoop& operator=(const EventLoop&) = delete;
+
+	// This calls the handler whenever the file descriptor is readable.
+	// Returns an error message or an empty string on success.
+	std::string Add(int fd, std::function<void()> handler);
+
+	// This stops calling the handler of a file descriptor
+	void Remove(int fd);
+
+	// This calls the handler every interval of milliseconds.
+	// Returns an error message or an empty string on success.
+	std::string AddTimer(uint interval_ms, std::function<void()> handler);
+
+	// This calls the handlers until Stop is called
+	void Run();
+
+	// This makes Run return after the current handler
+	void Stop() { stop = true; }
+};
@@ -0,0 +1,82 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <atomic>
+#include <iostream>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "Tools.h"
+
+// Wakes up a worker thread through an eventfd, which can also be waited for with poll or epoll.
+// A signal only makes a system call when no wakeup is pending yet, so signalling many times
+// before the worker wakes up costs a single atomic operation each. The worker must Clear the
+// signal before it takes the work, so that work added after that signals it again.
+class EventSignal final
+{
+private:
+
+	// The eventfd and whether a wakeup is pending on it
+	int fd;
+	std::atomic<bool> pending;
+
+public:
+
+	// Constructor
+	EventSignal() : pending(false)
+	{
+		fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if(fd < 0)
+			std::cout << "Error creating eventfd: " << strerror(errno) << std::endl;
+	}
+
+	// Destructor
+	~EventSignal()
+	{
+		if(fd >= 0)
+			close(fd);
+	}
+
+	// Not copyable, because the file descriptor is owned
+	EventSignal(const EventSignal&) = delete;
+	EventSignal& operator=(const EventSignal&) = delete;
+
+	// This wakes up the worker, unless a wakeup is pending already
+	void Signal()
+	{
+		if(pending.exchange(true, std::memory_order_acq_rel))
+			return;
+
+		uint64 one = 1;
+		if(write(fd, &one, sizeof(one)) != sizeof(one))
+			std::cout << "Error signalling eventfd: " << strerror(errno) << std::endl;
+	}
+
+	// This clears the signal. Work added after this signals again.
+	// The exchange acquires from the last Signal, so that work it found pending is seen
+	// by the worker, and releases to the next Signal, which then makes a system call.
+	void Clear()
+	{
+		uint64 count;
+		if((read(fd, &count, sizeof(count)) < 0) && (errno != EAGAIN))
+			std::cout << "Error reading eventfd: " << strerror(errno) << std::endl;
+		pending.exchange(false, std::memory_order_acq_rel);
+	}
+
+	// This waits indefinitely until a signal is given and clears it
+	void Wait()
+	{
+		pollfd pfd = { fd, POLLIN, 0 };
+		while((poll(&pfd, 1, -1) < 0) && (errno == EINTR))
+		{
+		}
+		Clear();
+	}
+
+	// Returns the file descriptor which becomes readable when signalled
+	int GetFd() const { return fd; }
+};
@@ -2,47 +2,54 @@
 	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
 	This software is released under MIT license.
 */
-#include <iostream>
+#include <unistd.h>
+#include <errno.h>
 #include "InputHandler.h"
 
 // Constructor
 InputHandler::InputHandler(bool _exitonenter) :
 	exitonenter(_exitonenter),
 	exitsignal(false),
-	thread(nullptr)
+	endofinput(false)
 {
-	// Create a separate thread to handle input
-	thread = new std::thread(&InputHandler::Thread, this);
 }
 
 // Destructor
 InputHandler::~InputHandler()
 {
-	// Clean up
-	thread->detach();
-	delete thread;
-	thread = nullptr;
 }
 
-// This is the thread that waits for a signal and handles it.
-void InputHandler::Thread()
+// This reads the input that is waiting and handles it
+void InputHandler::HandleInput()
 {
-	while(true)
+	// Only read what is waiting, so that this never blocks
+	char buffer[256];
+	ssize_t length = read(STDIN_FILENO, buffer, sizeof(buffer));
+	if(length == 0)
 	{
-		if(exitonenter)
+		endofinput = true;
+		return;
+	}
+	if(length < 0)
+	{
+		if((errno != EAGAIN) && (errno != EINTR))
+			endofinput = true;
+		return;
+	}
+
+	// Check if ENTER is pressed, all other input is ignored
+	if(exitonenter)
+	{
+		for(ssize_t i = 0; i < length; i++)
 		{
-			// Check if ENTER is pressed
-			if(std::cin.get() == '\n')
-			{
+			if(buffer[i] == '\n')
 				exitsignal = true;
-				return;
-			}
-		}
-		else
-		{
-			// Ignore all input
-			std::cin.ignore();
 		}
 	}
 }
 
+// Returns the file descriptor of the input
+int InputHandler::GetFd() const
+{
+	return STDIN_FILENO;
+}
@@ -3,17 +3,19 @@
 	This software is released under MIT license.
 */
 #pragma once
-#include <thread>
-#include <atomic>
 
+/*
+	This handles the input on stdin. The owner waits for stdin to become
+	readable (see EventLoop) and calls HandleInput.
+*/
 class InputHandler final
 {
 private:
 
 	// Members
 	bool exitonenter;
-	std::atomic<bool> exitsignal;
-	std::thread* thread;
+	bool exitsignal;
+	bool endofinput;
 
 public:
 
@@ -21,9 +23,13 @@ public:
 	InputHandler(bool _exitonenter);
 	~InputHandler();
 
-	// This is the thread that waits for a signal and handles it.
-	void Thread();
+	// This reads the input that is waiting and handles it
+	void HandleInput();
 
 	// Getters/setters
+	int GetFd() const;
 	bool GetExitSignal() const { return exitsignal; }
+
+	// Returns True when stdin is closed, after which it should no longer be waited for
+	bool GetEndOfInput() const { return endofinput; }
 };
@@ -0,0 +1,78 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include "Tools.h"
+
+/*
+	Layout of an event journal (.kjnl) with the messages decoded by kakunu.
+
+	The journal begins with a JournalFileHeader, followed by records of a fixed size, so that the
+	file can be memory mapped and addressed as an array. After every INDEX_INTERVAL event records
+	an index record follows, which holds the time range of the events before it and a small bloom
+	filter of their addresses. Because the index records are at fixed positions, a time can be
+	found with a binary search over the index records and spans without a wanted address can be
+	skipped. The events after the last index record are searched one by one.
+
+	The journal is only ever appended to. Events are written in order of time.
+*/
+struct JournalFormat
+{
+	static constexpr uint VERSION = 1;
+	static constexpr uint INDEX_INTERVAL = 256;
+
+	// The address of a message is in its first symbols
+	static constexpr uint ADDRESS_SYMBOLS = 26;
+
+	// Record types
+	static constexpr unsigned char EVENT_RECORD = 1;
+	static constexpr unsigned char INDEX_RECORD = 2;
+
+	// Event flags
+	static constexpr unsigned char CORRECTED_FLAG = 1;
+
+	// This returns the address of a message from its first word of packed symbols
+	static inline uint64 GetAddress(uint64 symbols)
+	{
+		return symbols & ((1ULL << (ADDRESS_SYMBOLS * 2)) - 1);
+	}
+
+	// This returns the bloom filter bits for an address
+	static inline uint64 GetAddressBloom(uint64 address)
+	{
+		uint64 hash = address * 0x9E3779B97F4A7C15ULL;
+		return (1ULL << (hash >> 58)) | (1ULL << ((hash >> 52) & 63));
+	}
+};
+
+// Header at the start of the journal
+struct JournalFileHeader
+{
+	char magic[4];			// "KJNL"
+	uint version;
+	uint recordsize;
+	uint indexinterval;
+	uint64 created;			// Wall clock time at which the journal was made, in microseconds since the epoch
+	uint64 reserved;
+};
+
+// A record in the journal.
+// For an index record, time is the time of the first event in the span, symbols[0] is the time of
+// the last event in the span, symbols[1] is the bloom filter of the addresses in the span and
+// repeats is the number of events in the span.
+struct JournalRecord
+{
+	uint64 time;			// Wall clock time of the first transmission, in microseconds since the epoch
+	uint64 symbols[2];		// Packed symbols (see KakuMessage)
+	unsigned char type;		// EVENT_RECORD or INDEX_RECORD
+	unsigned char length;	// Number of symbols
+	unsigned char pin;		// Input pin on which the message was received
+	unsigned char quality;	// Best quality of the transmissions, in percent
+	uint16 repeats;			// Number of times the message was transmitted
+	unsigned char protocol;	// Protocol of the message (see KakuProtocol)
+	unsigned char flags;	// CORRECTED_FLAG when any transmission was corrected to a known code
+};
+
+static_assert(sizeof(JournalFileHeader) == 32, "Unexpected journal header size");
+static_assert(sizeof(JournalRecord) == 32, "Unexpected journal record size");
@@ -0,0 +1,241 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <iostream>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "JournalWriter.h"
+
+// Constructor
+JournalWriter::JournalWriter() :
+	fd(-1),
+	pin(0),
+	timebase(0),
+	pending(false),
+	pendingevent(),
+	pendinglasttime(0),
+	span(),
+	lasttime(0),
+	eventcount(0),
+	rejectedcount(0)
+{
+}
+
+// Destructor
+JournalWriter::~JournalWriter()
+{
+	Close();
+}
+
+// This opens or creates the journal. An incomplete record at the end is removed.
+// Returns an error message or an empty string on success.
+std::string JournalWriter::Open(const std::string& filename)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	fd = open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	if(fd < 0)
+		return "Unable to open " + filename + ": " + strerror(errno);
+
+	struct stat info;
+	if(fstat(fd, &info) != 0)
+	{
+		std::string error = "Unable to open " + filename + ": " + strerror(errno);
+		close(fd);
+		fd = -1;
+		return error;
+	}
+
+	JournalFileHeader header;
+	uint64 size = static_cast<uint64>(info.st_size);
+	if(size == 0)
+	{
+		// New journal
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "KJNL", 4);
+		header.version = JournalFormat::VERSION;
+		header.recordsize = sizeof(JournalRecord);
+		header.indexinterval = JournalFormat::INDEX_INTERVAL;
+		header.created = static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count());
+		if(write(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)))
+		{
+			std::string error = "Unable to write " + filename + ": " + strerror(errno);
+			close(fd);
+			fd = -1;
+			return error;
+		}
+		size = sizeof(header);
+	}
+	else if((pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) ||
+			(memcmp(header.magic, "KJNL", 4) != 0) || (header.version != JournalFormat::VERSION) ||
+			(header.recordsize != sizeof(JournalRecord)) || (header.indexinterval != JournalFormat::INDEX_INTERVAL))
+	{
+		close(fd);
+		fd = -1;
+		return "Unable to open " + filename + ": not a journal.";
+	}
+
+	// Remove an incomplete record that was left by an interruption
+	uint64 records = (size - sizeof(header)) / sizeof(JournalRecord);
+	uint64 validsize = sizeof(header) + records * sizeof(JournalRecord);
+	if((validsize != size) && (ftruncate(fd, static_cast<off_t>(validsize)) != 0))
+	{
+		std::string error = "Unable to repair " + filename + ": " + strerror(errno);
+		close(fd);
+		fd = -1;
+		return error;
+	}
+
+	LoadSpan(records);
+	pending = false;
+	eventcount = 0;
+	rejectedcount = 0;
+	return std::string();
+}
+
+// This rebuilds the span from the events after the last index record
+// and finds the time of the newest event.
+void JournalWriter::LoadSpan(uint64 records)
+{
+	memset(&span, 0, sizeof(span));
+	span.type = JournalFormat::INDEX_RECORD;
+	lasttime = 0;
+
+	// The last record is the newest event, or an index record which has its time
+	if(records > 0)
+	{
+		JournalRecord record;
+		off_t offset = static_cast<off_t>(sizeof(JournalFileHeader) + (records - 1) * sizeof(JournalRecord));
+		if(pread(fd, &record, sizeof(record), offset) == static_cast<ssize_t>(sizeof(record)))
+			lasttime = (record.type == JournalFormat::INDEX_RECORD) ? record.symbols[0] : record.time;
+	}
+
+	uint64 first = (records / (JournalFormat::INDEX_INTERVAL + 1)) * (JournalFormat::INDEX_INTERVAL + 1);
+	for(uint64 r = first; r < records; r++)
+	{
+		JournalRecord record;
+		off_t offset = static_cast<off_t>(sizeof(JournalFileHeader) + r * sizeof(JournalRecord));
+		if(pread(fd, &record, sizeof(record), offset) != static_cast<ssize_t>(sizeof(record)))
+			break;
+
+		if(span.repeats == 0)
+			span.time = record.time;
+		span.symbols[0] = record.time;
+		span.symbols[1] |= JournalFormat::GetAddressBloom(JournalFormat::GetAddress(record.symbols[0]));
+		span.repeats++;
+	}
+
+	// The index record may not have been written before an interruption
+	if(span.repeats == JournalFormat::INDEX_INTERVAL)
+	{
+		WriteRecord(span);
+		memset(&span, 0, sizeof(span));
+		span.type = JournalFormat::INDEX_RECORD;
+	}
+}
+
+// This adds a decoded message
+void JournalWriter::AddMessage(const KakuMessage& msg)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if(fd < 0)
+		return;
+
+	// Another transmission of the pending event?
+	if(pending && (msg.length == pendingevent.length) && (static_cast<uint>(msg.protocol) == pendingevent.protocol) &&
+	   (msg.symbols[0] == pendingevent.symbols[0]) && (msg.symbols[1] == pendingevent.symbols[1]) &&
+	   (msg.time >= pendinglasttime) && ((msg.time - pendinglasttime) <= REPEAT_WINDOW_US))
+	{
+		if(pendingevent.repeats < 0xFFFF)
+			pendingevent.repeats++;
+		if(msg.quality > pendingevent.quality)
+			pendingevent.quality = static_cast<unsigned char>(msg.quality);
+		if(msg.corrected)
+			pendingevent.flags |= JournalFormat::CORRECTED_FLAG;
+		pendinglasttime = msg.time;
+		pendingactivity = std::chrono::steady_clock::now();
+		return;
+	}
+
+	// The journal must stay in order of time
+	uint64 time = timebase + msg.time;
+	if(time < lasttime)
+	{
+		rejectedcount++;
+		return;
+	}
+
+	WritePending();
+
+	memset(&pendingevent, 0, sizeof(pendingevent));
+	pendingevent.time = time;
+	pendingevent.symbols[0] = msg.symbols[0];
+	pendingevent.symbols[1] = msg.symbols[1];
+	pendingevent.type = JournalFormat::EVENT_RECORD;
+	pendingevent.length = static_cast<unsigned char>(msg.length);
+	pendingevent.pin = static_cast<unsigned char>(pin);
+	pendingevent.quality = static_cast<unsigned char>(msg.quality);
+	pendingevent.repeats = 1;
+	pendingevent.protocol = static_cast<unsigned char>(msg.protocol);
+	pendingevent.flags = msg.corrected ? JournalFormat::CORRECTED_FLAG : 0;
+	pendinglasttime = msg.time;
+	pendingactivity = std::chrono::steady_clock::now();
+	pending = true;
+	lasttime = time;
+}
+
+// This writes the pending event when no repeats arrived for a while
+void JournalWriter::FlushIdle()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if(pending && ((std::chrono::steady_clock::now() - pendingactivity) > std::chrono::microseconds(REPEAT_WINDOW_US)))
+		WritePending();
+}
+
+// This writes the pending event and an index record when a span is complete.
+// The mutex must be locked by the caller.
+void JournalWriter::WritePending()
+{
+	if(!pending || (fd < 0))
+		return;
+
+	pending = false;
+	WriteRecord(pendingevent);
+	eventcount++;
+
+	if(span.repeats == 0)
+		span.time = pendingevent.time;
+	span.symbols[0] = pendingevent.time;
+	span.symbols[1] |= JournalFormat::GetAddressBloom(JournalFormat::GetAddress(pendingevent.symbols[0]));
+	span.repeats++;
+
+	if(span.repeats == JournalFormat::INDEX_INTERVAL)
+	{
+		WriteRecord(span);
+		memset(&span, 0, sizeof(span));
+		span.type = JournalFormat::INDEX_RECORD;
+	}
+}
+
+// This writes a record at the end of the file
+void JournalWriter::WriteRecord(const JournalRecord& record)
+{
+	if(write(fd, &record, sizeof(record)) != static_cast<ssize_t>(sizeof(record)))
+		std::cout << "Error writing to journal: " << strerror(errno) << std::endl;
+}
+
+// This writes the pending event and closes the journal
+void JournalWriter::Close()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if(fd < 0)
+		return;
+
+	WritePending();
+	close(fd);
+	fd = -1;
+}
@@ -0,0 +1,89 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <mutex>
+#include <chrono>
+#include "Tools.h"
+#include "KakuMessage.h"
+#include "JournalFormat.h"
+
+/*
+	This appends decoded messages to an event journal (see JournalFormat.h).
+	Remote controls send the same message several times. These transmissions are
+	written as a single event with a repeat count, once no more repeats arrive.
+*/
+class JournalWriter
+{
+private:
+
+	// Constants
+	// Transmissions of the same message within this time are counted as repeats
+	const uint64 REPEAT_WINDOW_US = 250000;
+
+	// The file we append to
+	int fd;
+
+	// Mutex for thread synchronization
+	std::mutex mutex;
+
+	// Input pin written with the events
+	uint pin;
+
+	// Added to the time of a message to make it wall clock time
+	uint64 timebase;
+
+	// The event waiting for more repeats
+	bool pending;
+	JournalRecord pendingevent;
+	uint64 pendinglasttime;
+	std::chrono::steady_clock::time_point pendingactivity;
+
+	// The span of events since the last index record
+	JournalRecord span;
+
+	// Time of the newest event in the journal (or pending for it). The reader searches the
+	// journal by time, so events which are older than this are not written.
+	uint64 lasttime;
+
+	// Number of events written and not written because they were older than the journal
+	uint64 eventcount;
+	uint64 rejectedcount;
+
+	// This writes the pending event and an index record when a span is complete
+	void WritePending();
+
+	// This writes a record at the end of the file
+	void WriteRecord(const JournalRecord& record);
+
+	// This rebuilds the span from the events after the last index record
+	void LoadSpan(uint64 records);
+
+public:
+
+	// Constructor / destructor
+	JournalWriter();
+	virtual ~JournalWriter();
+
+	// This opens or creates the journal. An incomplete record at the end is removed.
+	// Returns an error message or an empty string on success.
+	std::string Open(const std::string& filename);
+
+	// This adds a decoded message. A message older than the newest event is rejected.
+	void AddMessage(const KakuMessage& msg);
+
+	// This writes the pending event when no repeats arrived for a while
+	void FlushIdle();
+
+	// This writes the pending event and closes the journal
+	void Close();
+
+	// Getters / setters
+	void SetPin(uint inputpin) { pin = inputpin; }
+	void SetTimeBase(uint64 microseconds) { timebase = microseconds; }
+	uint64 GetEventCount() { return eventcount; }
+	uint64 GetRejectedCount() { return rejectedcount; }
+	uint64 GetLastTime() { return lasttime; }
+};
@@ -4,24 +4,61 @@
 */
 #include <iostream>
 #include <string>
-#include <sstream>
+#include <limits>
 #include "KakuDecoder.h"
 
 // Constructor
-KakuDecoder::KakuDecoder() :
-	stopprocessingthread(false)
+KakuDecoder::KakuDecoder(bool startthread) :
+	queuecapacity(DEFAULT_QUEUE_CAPACITY),
+	queuepolicy(QueuePolicy::DropOldest),
+	enqueuedcount(0),
+	droppedcount(0),
+	queuedepth(0),
+	codedepth(0),
+	highwatermark(0),
+	latencycount(0),
+	latencytotal(0),
+	latencymax(0),
+	stopprocessingthread(false),
+	codecorrector(nullptr),
+	addressfilter(nullptr)
 {
+	// Register the protocols. The self-learning protocol has a start marker of its own,
+	// so we only require the end marker. Tri-state and EV1527 messages begin with their
+	// first bit and are made of the same pulses. A message which is valid in both
+	// protocols is taken as tri-state, so that one is registered first. Three of the four
+	// bit pairs are valid trits, so that is (3/4)^12, about 3.2% of random EV1527 codes.
+	DecoderRegistry::Signature selflearning = { SelfLearningSpec::MIN_TIMES, std::numeric_limits<uint>::max(),
+		{ DecoderRegistry::ANY_CLASS, DecoderRegistry::ANY_CLASS },
+		{ 1U << DecoderRegistry::Short, 1U << DecoderRegistry::Pause } };
+	registry.Register(KakuProtocol::SelfLearning, selflearning, &KakuSelfLearningDecoder::Decode);
+
+	uint bitclasses = (1U << DecoderRegistry::Short) | (1U << DecoderRegistry::Medium);
+	DecoderRegistry::Signature tristate = { TriStateDecoder::GetMessageTimes(), TriStateDecoder::GetMessageTimes(),
+		{ bitclasses, bitclasses },
+		{ 1U << DecoderRegistry::Short, 1U << DecoderRegistry::Pause } };
+	registry.Register(KakuProtocol::TriState, tristate, &TriStateDecoder::Decode);
+
+	DecoderRegistry::Signature ev1527 = { EV1527Decoder::GetMessageTimes(), EV1527Decoder::GetMessageTimes(),
+		{ bitclasses, bitclasses },
+		{ 1U << DecoderRegistry::Short, 1U << DecoderRegistry::Pause } };
+	registry.Register(KakuProtocol::EV1527, ev1527, &EV1527Decoder::Decode);
+
 	// Start the background thread
-	processingthread = std::thread(std::bind(&KakuDecoder::ProcessingThread, this));
+	if(startthread)
+		processingthread = std::thread(std::bind(&KakuDecoder::ProcessingThread, this));
 }
 
 // Destructor
 KakuDecoder::~KakuDecoder()
 {
 	// Stop the background thread
-	stopprocessingthread = true;
-	threadsignal.Signal();
-	processingthread.join();
+	if(processingthread.joinable())
+	{
+		stopprocessingthread = true;
+		threadsignal.Signal();
+		processingthread.join();
+	}
 }
 
 // The thread for processing
@@ -29,198 +66,192 @@ void KakuDecoder::ProcessingThread()
 {
 	while(true)
 	{
-		receivemutex.lock();
-		if(receivedtimes.size() == 0)
-		{
-			// There is no work to do.
-			// Wait for a signal to indicate there is new work to do.
-			receivemutex.unlock();
-			threadsignal.Wait();
-
-			// Stop processing?
-			if(stopprocessingthread)
-				return;
+		// Wait for a signal to indicate there is new work to do.
+		// This clears the signal, so that messages which arrive from now on signal again.
+		threadsignal.Wait();
 
-			receivemutex.lock();
-		}
-
-		// Copy a set of times to process
-		std::vector<uint> times = receivedtimes.front();
-		receivedtimes.pop();
-		receivemutex.unlock();
+		// Stop processing?
+		if(stopprocessingthread)
+			return;
 
-		// Start crunching these numbers
-		Decode(times);
+		ProcessMessages();
 	}
 }
 
-// This starts decoding a message
-void KakuDecoder::DecodeMessage(const std::vector<uint>& times, uint64 starttime)
+// This invokes the callbacks for all known codes and messages that are waiting.
+// Used when the decoder has no processing thread, from the thread that polls the wakeup fd.
+void KakuDecoder::ProcessPending()
 {
-	std::lock_guard<std::mutex> lock(receivemutex);
-	receivedtimes.push(times);
-	threadsignal.Signal();
+	threadsignal.Clear();
+	ProcessMessages();
 }
 
-
-/*
-	'0' subbit:
-	 __ 
-	|  |___
-
-	|--|--|
-	 T  T
-
-
-	'1' subbit:
-	 __ 
-	|  |______________
-
-	|--|-------------|
-	 T       5T
-
-
-	'START' signal:
-	 __             
-	|  |________________________________
-
-	|--|-------------------------------|
-	 T              10T
-
-
-	'STOP' signal:
-	 __             
-	|  |________________________________ _ _ _ _____
-
-	|--|-------------------------------- - - - ----|
-	 T                      40T
-
-	T ~ 250 us (Short)
-	5T ~ 1250 us (Long)
-	10T ~ 2500 us (ExtraLong)
-	40T ~ 10 ms (MegaLong)
-
-	Bit encoding: 0 bit = subbits 0 1
-	              1 bit = subbits 1 0
-	For example, the bits 0111 are encoded as 01101010.
-	The extended protocol for dimmers contains additional bit combinations:
-				  2 bit = subbits 0 0
-				  3 bit = subbits 1 1
-*/
-// This crunches the numbers. This runs in the processing thread.
-void KakuDecoder::Decode(const std::vector<uint>& times)
+// This takes all waiting known codes and messages and invokes the callbacks for them
+void KakuDecoder::ProcessMessages()
 {
-	// Check if we have received a minimum number of times to allow parsing
-	if(times.size() < 6)
+	// Hand over the known codes
+	KnownCode code;
+	while(knowncodes.Pop(code))
 	{
-		if(errorcallback != nullptr)
-			errorcallback("Message could not be decoded. Insufficient data received.");
-		return;
+		codedepth = knowncodes.GetSize();
+		AddLatency(code.receivedtime);
+		Deliver(true, code.message, std::string());
 	}
 
-	// First change the times into a code scheme which is easier to process.
-	std::vector<Timecode> timecodes;
-	timecodes.reserve(times.size());
-	for(uint t : times)
+	// Take all waiting messages at once, so that the receiver
+	// only has to wait for the lock once for the whole batch.
+	std::queue<ReceivedTimes> batch;
 	{
-		if((t >= MIN_SHORT_US) && (t <= MAX_SHORT_US))
-			timecodes.push_back(Timecode::Short);
-		else if((t >= MIN_LONG_US) && (t <= MAX_LONG_US))
-			timecodes.push_back(Timecode::Long);
-		else if((t >= MIN_EXTRALONG_US) && (t <= MAX_EXTRALONG_US))
-			timecodes.push_back(Timecode::ExtraLong);
-		else if(t >= MIN_MEGALONG_US)
-			timecodes.push_back(Timecode::MegaLong);
-		else
-		{
-			if(errorcallback != nullptr)
-				errorcallback("Message could not be decoded. Invalid timings received.");
-			return;
-		}
+		std::lock_guard<std::mutex> lock(receivemutex);
+		batch.swap(receivedtimes);
+		queuedepth = 0;
 	}
 
-	// Find the start of the message.
-	// This consists of a short high and an extralong low. Because the timecodes are alternating high and low signals,
-	// we scan through these with a step size of 2 so that 'i' is always at a high signal.
-	size_t startindex = 0;
-	for(size_t i = 0; i < (timecodes.size() - 2); i += 2)
+	// Start crunching these numbers
+	while(!batch.empty())
 	{
-		if((timecodes[i] == Timecode::Short) && (timecodes[i + 1] == Timecode::ExtraLong))
-		{
-			startindex = i + 2;
-			break;
-		}
+		ReceivedTimes& received = batch.front();
+		KakuMessage message;
+		std::string error;
+		bool decoded = DecodeResult(received.times, received.starttime, message, error);
+		if(decoded || (error.size() > 0))
+			AddLatency(received.receivedtime);
+		Deliver(decoded, message, error);
+		batch.pop();
 	}
+}
 
-	// The message never starts at index 0, because the start marker
-	// (right before the actual message) is 2 signals long.
-	if(startindex == 0)
-	{
-		if(errorcallback != nullptr)
-			errorcallback("Message could not be decoded. Start marker not found.");
-		return;
-	}
+// This starts decoding a message
+void KakuDecoder::DecodeMessage(const std::vector<uint16>& times, uint64 starttime)
+{
+	std::lock_guard<std::mutex> lock(receivemutex);
 
-	// Parse the timecodes into subbits.
-	// Again, we do this in steps of 2 signals (a high and a low) because
-	// all subbits and the end marker come in pairs.
-	bool endmarkerfound = false;
-	std::vector<int> subbits;
-	subbits.reserve((timecodes.size() - startindex) / 2);
-	for(size_t i = startindex; i < (timecodes.size() - 1); i += 2)
+	// When the queue is full, either the oldest or this new message must go
+	if(receivedtimes.size() >= queuecapacity)
 	{
-		Timecode t1 = timecodes[i];
-		Timecode t2 = timecodes[i + 1];
-		
-		if((t1 == Timecode::Short) && (t2 == Timecode::Short))
-			subbits.push_back(0);
-		else if((t1 == Timecode::Short) && (t2 == Timecode::Long))
-			subbits.push_back(1);
-		else if((t1 == Timecode::Short) && (t2 == Timecode::MegaLong))
+		if(queuepolicy == QueuePolicy::DropNewest)
 		{
-			endmarkerfound = true;
-			break;
+			droppedcount++;
+			return;
 		}
-		else
+
+		while(receivedtimes.size() >= queuecapacity)
 		{
-			if(errorcallback != nullptr)
-				errorcallback("Message could not be decoded. Invalid signals received.");
-			return;
+			receivedtimes.pop();
+			droppedcount++;
 		}
 	}
 
-	// Check if the end marker is actually received.
-	if(!endmarkerfound)
+	receivedtimes.push({ times, starttime, std::chrono::steady_clock::now() });
+	enqueuedcount++;
+	queuedepth = receivedtimes.size();
+	if(receivedtimes.size() > highwatermark)
+		highwatermark = receivedtimes.size();
+
+	threadsignal.Signal();
+}
+
+// This hands a known code recognized by the receiver to the processing thread, after the
+// corrector and the filter. Only the filter and the lock-free ring are involved, so this never waits.
+void KakuDecoder::AddKnownCode(const KakuMessage& code)
+{
+	KnownCode known;
+	known.message = code;
+	known.receivedtime = std::chrono::steady_clock::now();
+	if(!CheckResult(known.message))
+		return;
+
+	// When the ring is full, the processing thread is far behind and the new code must go
+	if(!knowncodes.Push(known))
 	{
-		if(errorcallback != nullptr)
-			errorcallback("Message could not be decoded. End marker not found.");
+		droppedcount++;
 		return;
 	}
 
-	// Pair the subbits into bits.
-	std::vector<int> bits;
-	bits.reserve(subbits.size() / 2);
-	for(size_t i = 0; i < (subbits.size() - 1); i += 2)
+	enqueuedcount++;
+	std::size_t depth = knowncodes.GetSize();
+	codedepth = depth;
+	if(depth > highwatermark)
+		highwatermark = depth;
+
+	threadsignal.Signal();
+}
+
+// This hands a known code to the callbacks on the calling thread, after the corrector and the filter
+void KakuDecoder::AddKnownCodeNow(const KakuMessage& code)
+{
+	KakuMessage message = code;
+	if(CheckResult(message))
+		Deliver(true, message, std::string());
+}
+
+// This adds the time since a message was received to the latency statistics
+void KakuDecoder::AddLatency(std::chrono::steady_clock::time_point receivedtime)
+{
+	uint64 latency = static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - receivedtime).count());
+	latencycount++;
+	latencytotal += latency;
+	uint64 max = latencymax;
+	while((latency > max) && !latencymax.compare_exchange_weak(max, latency))
 	{
-		int sb1 = subbits[i];
-		int sb2 = subbits[i + 1];
-
-		if((sb1 == 0) && (sb2 == 1))
-			bits.push_back(0);
-		else if((sb1 == 1) && (sb2 == 0))
-			bits.push_back(1);
-		else if((sb1 == 0) && (sb2 == 0))
-			bits.push_back(2);
-		else
-			bits.push_back(3);
 	}
+}
 
-	if(resultcallback != nullptr)
+// Sets the maximum number of messages waiting to be decoded
+void KakuDecoder::SetQueueCapacity(std::size_t capacity)
+{
+	std::lock_guard<std::mutex> lock(receivemutex);
+
+	// We need room for at least one message
+	queuecapacity = (capacity > 0) ? capacity : 1;
+}
+
+// This crunches the numbers and invokes the callbacks
+void KakuDecoder::Decode(const std::vector<uint16>& times, uint64 starttime)
+{
+	KakuMessage message;
+	std::string error;
+	bool decoded = DecodeResult(times, starttime, message, error);
+	Deliver(decoded, message, error);
+}
+
+// This decodes a message and applies the corrector and the filter.
+// Returns False when there is no result, with the error message when it could not be decoded.
+bool KakuDecoder::DecodeResult(const std::vector<uint16>& times, uint64 starttime, KakuMessage& message, std::string& error)
+{
+	message.time = starttime;
+	error = registry.Decode(times, message);
+	if(error.size() > 0)
+		return false;
+
+	return CheckResult(message);
+}
+
+// This applies the corrector and the filter to a message.
+// Returns False when the filter does not accept the message.
+bool KakuDecoder::CheckResult(KakuMessage& message)
+{
+	if(codecorrector != nullptr)
+		codecorrector->Correct(message);
+
+	if((addressfilter != nullptr) && !addressfilter->Accept(message))
+		return false;
+
+	return true;
+}
+
+// This invokes the callbacks for the result of a message
+void KakuDecoder::Deliver(bool decoded, const KakuMessage& message, const std::string& error)
+{
+	if(decoded)
 	{
-		// Make the result and invoke the callback
-		std::stringstream str;
-		for(int b : bits)
-			str << b;
-		resultcallback(str.str());
+		if(resultcallback != nullptr)
+			resultcallback(message);
+	}
+	else if(error.size() > 0)
+	{
+		if(errorcallback != nullptr)
+			errorcallback(error);
 	}
 }
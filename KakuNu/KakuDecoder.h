@@ -9,61 +9,176 @@
 #include <functional>
 #include <queue>
 #include <mutex>
+#include <chrono>
 #include "Tools.h"
-#include "Synchronizer.h"
+#include "EventSignal.h"
+#include "RingBuffer.h"
+#include "KakuMessage.h"
+#include "AddressFilter.h"
+#include "CodeCorrector.h"
+#include "DecoderRegistry.h"
+#include "SelfLearningDecoder.h"
+#include "PulseCodeDecoder.h"
 
 class KakuDecoder
 {
+public:
+
+	// What to do with a new message when the queue is full
+	enum class QueuePolicy : int
+	{
+		DropOldest = 0,
+		DropNewest = 1
+	};
+
 private:
 
-	// Timings
-	// Anyhting in between these ranges is unsure and thus invalid.
-	// Anything longer than MIN_MEGALONG_US is considered mega long.
-	const uint MIN_SHORT_US = 100;
-	const uint MAX_SHORT_US = 500;
-	const uint MIN_LONG_US = 900;
-	const uint MAX_LONG_US = 1800;
-	const uint MIN_EXTRALONG_US = 2000;
-	const uint MAX_EXTRALONG_US = 3200;
-	const uint MIN_MEGALONG_US = 5000;
-
-	// Coding scheme for timings
-	enum class Timecode : int
+	// Default maximum number of messages waiting to be decoded
+	const std::size_t DEFAULT_QUEUE_CAPACITY = 64;
+
+	// Number of known codes that can wait for the processing thread
+	static constexpr std::size_t CODE_RING_CAPACITY = 64;
+
+	// A message as received from RFReceiver
+	struct ReceivedTimes
 	{
-		Short = 0,
-		Long = 1,
-		ExtraLong = 2,
-		MegaLong = 3
+		std::vector<uint16> times;
+		uint64 starttime;
+		std::chrono::steady_clock::time_point receivedtime;
+	};
+
+	// A known code as recognized by RFReceiver
+	struct KnownCode
+	{
+		KakuMessage message;
+		std::chrono::steady_clock::time_point receivedtime;
 	};
 
 	// To alleviate the callback from RFReceiver, we store the received data
 	// in an array and process the data in a separate thread.
-	std::queue<std::vector<uint>> receivedtimes;
+	// The queue is bounded, so that a noisy channel or a stalled consumer
+	// cannot make it grow without limit.
+	std::queue<ReceivedTimes> receivedtimes;
 	std::mutex receivemutex;
+	std::size_t queuecapacity;
+	QueuePolicy queuepolicy;
+
+	// Known codes, which are handed to the callbacks by the processing thread
+	RingBuffer<KnownCode, CODE_RING_CAPACITY> knowncodes;
+
+	// Queue statistics. These count the messages and the known codes. The depths of the
+	// message queue and of the known codes are kept apart, because they are taken at
+	// different times. The high water mark is the highest of either.
+	std::atomic<uint64> enqueuedcount;
+	std::atomic<uint64> droppedcount;
+	std::atomic<std::size_t> queuedepth;
+	std::atomic<std::size_t> codedepth;
+	std::atomic<std::size_t> highwatermark;
 
-	// The thread for processing
+	// Time from receiving a message or known code until its result is handed to the callbacks,
+	// in nanoseconds.
+	std::atomic<uint64> latencycount;
+	std::atomic<uint64> latencytotal;
+	std::atomic<uint64> latencymax;
+	void AddLatency(std::chrono::steady_clock::time_point receivedtime);
+
+	// The thread for processing. The signal is given when there is new work, but only
+	// makes a system call when the processing thread was not signalled already.
 	std::thread processingthread;
-	Synchronizer threadsignal;
+	EventSignal threadsignal;
 	std::atomic<bool> stopprocessingthread;
 	void ProcessingThread();
 
-	// This crunches the numbers
-	void Decode(const std::vector<uint>& times);
+	// This takes all waiting known codes and messages and invokes the callbacks for them
+	void ProcessMessages();
+
+	// This crunches the numbers and invokes the callbacks
+	void Decode(const std::vector<uint16>& times, uint64 starttime);
+
+	// This invokes the callbacks for the result of a message
+	void Deliver(bool decoded, const KakuMessage& message, const std::string& error);
+
+	// This decodes a message and applies the corrector and the filter.
+	// Returns False when there is no result, with the error message when it could not be decoded.
+	bool DecodeResult(const std::vector<uint16>& times, uint64 starttime, KakuMessage& message, std::string& error);
+
+	// This applies the corrector and the filter to a message.
+	// Returns False when the filter does not accept the message.
+	bool CheckResult(KakuMessage& message);
+
+	// The protocols we can decode
+	DecoderRegistry registry;
+
+	// Messages near a known code are corrected before the filter
+	CodeCorrector* codecorrector;
+
+	// Messages which are not accepted by the filter are dropped before the result callback
+	AddressFilter* addressfilter;
 
 	// Callbacks invoked for the results
-	std::function<void(const std::string& result)> resultcallback;
+	std::function<void(const KakuMessage& result)> resultcallback;
 	std::function<void(const std::string& message)> errorcallback;
 
 public:
 
-	// Constructor / destructor
-	KakuDecoder();
+	// Constructor / destructor. Without a processing thread of its own, the owner
+	// must call ProcessPending when the wakeup fd becomes readable.
+	KakuDecoder(bool startthread = true);
 	virtual ~KakuDecoder();
 
 	// This starts decoding a message
-	void DecodeMessage(const std::vector<uint>& times, uint64 starttime);
+	void DecodeMessage(const std::vector<uint16>& times, uint64 starttime);
+
+	// This decodes a message on the calling thread, bypassing the queue.
+	// Used for offline decoding, where messages must not be dropped.
+	void DecodeMessageNow(const std::vector<uint16>& times, uint64 starttime) { Decode(times, starttime); }
+
+	// This invokes the callbacks for all known codes and messages that are waiting.
+	// Used when the decoder has no processing thread, from the thread that polls the wakeup fd.
+	void ProcessPending();
+
+	// This hands a known code recognized by the receiver to the processing thread, after the
+	// corrector and the filter like a decoded message. Used on the receiver thread, because this
+	// never waits for another thread. It must always be called from the same thread.
+	void AddKnownCode(const KakuMessage& code);
+
+	// This hands a known code to the callbacks on the calling thread, after the corrector and the filter.
+	// Used for offline decoding.
+	void AddKnownCodeNow(const KakuMessage& code);
 
 	// Getters/setters
-	void SetResultCallback(std::function<void(const std::string& result)> f) { resultcallback = f; }
+	void SetResultCallback(std::function<void(const KakuMessage& result)> f) { resultcallback = f; }
 	void SetErrorCallback(std::function<void(const std::string& message)> f) { errorcallback = f; }
+	void SetCodeCorrector(CodeCorrector* corrector) { codecorrector = corrector; }
+	void SetAddressFilter(AddressFilter* filter) { addressfilter = filter; }
+	void SetQueueCapacity(std::size_t capacity);
+	std::size_t GetQueueCapacity() { return queuecapacity; }
+	void SetQueuePolicy(QueuePolicy policy) { queuepolicy = policy; }
+	QueuePolicy GetQueuePolicy() { return queuepolicy; }
+
+	// The windows of the pulse classes by which messages are given to the protocols.
+	// These can be changed while decoding. Returns an error message or an empty string on success.
+	std::string SetWindows(const DecoderRegistry::Windows& w) { return registry.SetWindows(w); }
+	const DecoderRegistry::Windows& GetWindows() const { return registry.GetWindows(); }
+
+	// Returns the file descriptor which becomes readable when known codes or messages are waiting
+	int GetWakeupFd() const { return threadsignal.GetFd(); }
+
+	// Queue statistics (these can be read from any thread)
+	uint64 GetEnqueuedCount() const { return enqueuedcount; }
+	uint64 GetDroppedCount() const { return droppedcount; }
+	std::size_t GetQueueDepth() const { return queuedepth; }
+	std::size_t GetKnownCodeDepth() const { return codedepth; }
+	std::size_t GetHighWaterMark() const { return highwatermark; }
+
+	// Latency statistics in microseconds (these can be read from any thread)
+	uint64 GetLatencyCount() const { return latencycount; }
+	uint64 GetAverageLatency() const { return (latencycount > 0) ? (latencytotal / latencycount / 1000) : 0; }
+	uint64 GetMaxLatency() const { return latencymax / 1000; }
+
+	// Protocol statistics (these can be read from any thread)
+	std::vector<DecoderRegistry::Statistics> GetProtocolStatistics() const { return registry.GetStatistics(); }
+
+	// Returns the least number of timings a message of any protocol has
+	uint GetMinMessageTimes() const { return registry.GetMinTimes(); }
 };
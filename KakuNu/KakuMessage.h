@@ -0,0 +1,210 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include "Tools.h"
+
+// Protocols of decoded messages
+enum class KakuProtocol : uint
+{
+	// The self-learning KAKU protocol
+	SelfLearning = 0,
+
+	// EV1527 remotes and doorbells: 24 bits of 1T/3T or 3T/1T pulses
+	EV1527 = 1,
+
+	// The old KAKU protocol of switches with code wheels: 12 trits (0, 1 or F)
+	TriState = 2
+};
+
+/*
+	The fields of a self-learning KAKU message. The message has 32 symbols: 26 for the address,
+	1 for the group flag, 1 for the state and 4 for the unit. Dim messages have the state symbol 2
+	and 4 more symbols for the dim level. Numbers are sent with the highest bit first.
+*/
+struct KakuFields
+{
+	// State symbol
+	enum class State : int
+	{
+		Off = 0,
+		On = 1,
+		Dim = 2
+	};
+
+	uint address = 0;
+	bool group = false;
+	State state = State::Off;
+	uint unit = 0;
+	uint dimlevel = 0;
+};
+
+/*
+	A decoded message in packed form.
+	Every symbol (0, 1, 2 or 3) takes 2 bits. Symbol i is stored in bits 2*(i%32)
+	and 2*(i%32)+1 of symbols[i/32], so the first received symbol is in the lowest bits.
+	Bits beyond the length of the message are always 0.
+	Messages of other protocols than the self-learning KAKU protocol are packed the same way.
+*/
+struct KakuMessage
+{
+	// Maximum number of symbols a message can hold
+	static constexpr uint MAX_SYMBOLS = 64;
+	static constexpr uint SYMBOLS_PER_WORD = 32;
+	static constexpr uint NUM_WORDS = MAX_SYMBOLS / SYMBOLS_PER_WORD;
+
+	// Layout of the self-learning protocol (see KakuFields)
+	static constexpr uint FIELDS_SYMBOLS = 32;
+	static constexpr uint DIM_FIELDS_SYMBOLS = 36;
+	static constexpr uint ADDRESS_BITS = 26;
+	static constexpr uint STATE_SYMBOL = 27;
+	static constexpr uint64 LOW_BITS = 0x5555555555555555ULL;
+	static constexpr uint64 STATE_MASK = 3ULL << (STATE_SYMBOL * 2);
+
+	// Packed symbols
+	uint64 symbols[NUM_WORDS] = { };
+
+	// Number of symbols in the message
+	uint length = 0;
+
+	// Absolute time in microseconds at which the message started
+	uint64 time = 0;
+
+	// Percentage of the timings that were close to their nominal duration
+	uint quality = 0;
+
+	// Protocol in which the message was received
+	KakuProtocol protocol = KakuProtocol::SelfLearning;
+
+	// True when the symbols were corrected to those of the nearest known code
+	bool corrected = false;
+
+	// Returns the symbol at the specified index
+	uint GetSymbol(uint index) const
+	{
+		return static_cast<uint>(symbols[index / SYMBOLS_PER_WORD] >> ((index % SYMBOLS_PER_WORD) * 2)) & 3;
+	}
+
+	// This reads the fields of a self-learning KAKU message.
+	// Returns False when the message does not have the layout of one.
+	bool GetFields(KakuFields& fields) const
+	{
+		// All symbols must be binary, except for the state symbol which may also be 2
+		uint state = GetSymbol(STATE_SYMBOL);
+		if((protocol != KakuProtocol::SelfLearning) ||
+		   ((length != FIELDS_SYMBOLS) && (length != DIM_FIELDS_SYMBOLS)) || (state == 3) ||
+		   ((state == 2) != (length == DIM_FIELDS_SYMBOLS)) ||
+		   ((symbols[0] & ~STATE_MASK & ~LOW_BITS) != 0) || ((symbols[1] & ~LOW_BITS) != 0))
+			return false;
+
+		// After gathering and reversing, the first symbol is in the highest bit
+		uint bits = ReverseBits(GatherSymbols(symbols[0]));
+		fields.address = bits >> (32 - ADDRESS_BITS);
+		fields.group = ((bits >> 5) & 1) != 0;
+		fields.state = static_cast<KakuFields::State>(state);
+		fields.unit = bits & 15;
+		fields.dimlevel = (state == 2) ? (ReverseBits(GatherSymbols(symbols[1])) >> 28) : 0;
+		return true;
+	}
+
+	// This makes a self-learning KAKU message from the fields
+	void SetFields(const KakuFields& fields)
+	{
+		protocol = KakuProtocol::SelfLearning;
+		uint bits = ((fields.address & ((1U << ADDRESS_BITS) - 1)) << (32 - ADDRESS_BITS)) |
+			(fields.group ? (1U << 5) : 0) | (fields.unit & 15);
+		symbols[0] = SpreadSymbols(ReverseBits(bits)) | (static_cast<uint64>(fields.state) << (STATE_SYMBOL * 2));
+		if(fields.state == KakuFields::State::Dim)
+		{
+			symbols[1] = SpreadSymbols(ReverseBits((fields.dimlevel & 15) << 28));
+			length = DIM_FIELDS_SYMBOLS;
+		}
+		else
+		{
+			symbols[1] = 0;
+			length = FIELDS_SYMBOLS;
+		}
+	}
+
+	// This gathers the low bits of 32 binary symbols into 32 bits, symbol i in bit i
+	static uint GatherSymbols(uint64 word)
+	{
+		word &= LOW_BITS;
+		word = (word | (word >> 1)) & 0x3333333333333333ULL;
+		word = (word | (word >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+		word = (word | (word >> 4)) & 0x00FF00FF00FF00FFULL;
+		word = (word | (word >> 8)) & 0x0000FFFF0000FFFFULL;
+		word = (word | (word >> 16)) & 0x00000000FFFFFFFFULL;
+		return static_cast<uint>(word);
+	}
+
+	// This spreads 32 bits to 32 binary symbols, bit i to symbol i
+	static uint64 SpreadSymbols(uint bits)
+	{
+		uint64 word = bits;
+		word = (word | (word << 16)) & 0x0000FFFF0000FFFFULL;
+		word = (word | (word << 8)) & 0x00FF00FF00FF00FFULL;
+		word = (word | (word << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		word = (word | (word << 2)) & 0x3333333333333333ULL;
+		word = (word | (word << 1)) & LOW_BITS;
+		return word;
+	}
+
+	// This reverses the order of 32 bits
+	static uint ReverseBits(uint bits)
+	{
+		bits = ((bits >> 1) & 0x55555555U) | ((bits & 0x55555555U) << 1);
+		bits = ((bits >> 2) & 0x33333333U) | ((bits & 0x33333333U) << 2);
+		bits = ((bits >> 4) & 0x0F0F0F0FU) | ((bits & 0x0F0F0F0FU) << 4);
+		return __builtin_bswap32(bits);
+	}
+
+	// Returns the symbols as a string of digits, as used by kakusend
+	std::string ToString() const
+	{
+		std::string str(length, '0');
+		for(uint i = 0; i < length; i++)
+			str[i] = static_cast<char>('0' + GetSymbol(i));
+		return str;
+	}
+
+	// Returns the name of a protocol
+	static const char* GetProtocolName(KakuProtocol protocol)
+	{
+		switch(protocol)
+		{
+			case KakuProtocol::SelfLearning:
+				return "kaku";
+
+			case KakuProtocol::EV1527:
+				return "ev1527";
+
+			case KakuProtocol::TriState:
+				return "tristate";
+
+			default:
+				return "unknown";
+		}
+	}
+
+	// Returns the symbols as a string of digits. For other protocols than the
+	// self-learning KAKU protocol, the name of the protocol comes first.
+	// Trits are shown as 0, 1 and F, as used by kakusend.
+	// A corrected message is marked as such.
+	std::string ToLabeledString() const
+	{
+		std::string str = ToString();
+		if(protocol == KakuProtocol::TriState)
+		{
+			for(char& c : str)
+				c = (c == '2') ? 'F' : c;
+		}
+		if(protocol != KakuProtocol::SelfLearning)
+			str = std::string(GetProtocolName(protocol)) + " " + str;
+		if(corrected)
+			str += " (corrected)";
+		return str;
+	}
+};
@@ -0,0 +1,216 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "OokReader.h"
+
+// This skips spaces and tabs
+static const char* SkipSpaces(const char* p, const char* end)
+{
+	while((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r')))
+		p++;
+	return p;
+}
+
+// This parses an unsigned decimal number. Returns nullptr when there is no number.
+static const char* ParseNumber(const char* p, const char* end, uint64& value)
+{
+	const char* start = p;
+	value = 0;
+	while((p < end) && (*p >= '0') && (*p <= '9'))
+	{
+		value = value * 10 + static_cast<uint64>(*p - '0');
+		p++;
+	}
+	return (p == start) ? nullptr : p;
+}
+
+// This checks if the text starts with the specified keyword
+static bool StartsWith(const char* p, const char* end, const char* keyword)
+{
+	size_t length = strlen(keyword);
+	return (static_cast<size_t>(end - p) >= length) && (memcmp(p, keyword, length) == 0);
+}
+
+// Constructor
+OokReader::OokReader() :
+	timescale(1000),
+	time(0),
+	skippackage(false),
+	linenumber(0)
+{
+	edges.reserve(EDGE_BATCH_SIZE);
+}
+
+// Destructor
+OokReader::~OokReader()
+{
+}
+
+// This reads all pulses from the file and gives the edges to the receiver.
+// Returns an error message or an empty string on success.
+std::string OokReader::ReadFile(const std::string& filename, RFReceiver& receiver)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		return "Unable to open " + filename + ": " + strerror(errno);
+
+	std::vector<char> buffer(READ_BUFFER_SIZE);
+	std::size_t buffered = 0;
+	timescale = 1000;
+	skippackage = false;
+	linenumber = 0;
+	edges.clear();
+
+	// The file does not tell how long it was quiet before the first pulse,
+	// so we let it begin with the longest pause we can record.
+	time = static_cast<uint64>(MAX_PULSE_US) * 1000;
+
+	while(true)
+	{
+		ssize_t count = read(fd, buffer.data() + buffered, buffer.size() - buffered);
+		if(count < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			std::string error = "Unable to read " + filename + ": " + strerror(errno);
+			close(fd);
+			return error;
+		}
+
+		buffered += static_cast<std::size_t>(count);
+		bool endoffile = (count == 0);
+
+		// Parse all complete lines. At the end of the file, the last line may have no line ending.
+		const char* p = buffer.data();
+		const char* end = p + buffered;
+		while(p < end)
+		{
+			const char* eol = static_cast<const char*>(memchr(p, '\n', static_cast<std::size_t>(end - p)));
+			if(eol == nullptr)
+			{
+				if(!endoffile)
+					break;
+				eol = end;
+			}
+
+			linenumber++;
+			if(!ParseLine(p, eol, receiver))
+			{
+				close(fd);
+				return "Unable to read " + filename + ": invalid pulse data on line " + std::to_string(linenumber) + ".";
+			}
+
+			p = (eol < end) ? (eol + 1) : end;
+		}
+
+		if(endoffile)
+			break;
+
+		// Keep the incomplete line for the next read
+		std::size_t used = static_cast<std::size_t>(p - buffer.data());
+		if(used == 0)
+		{
+			close(fd);
+			return "Unable to read " + filename + ": line " + std::to_string(linenumber + 1) + " is too long.";
+		}
+		buffered -= used;
+		if(buffered > 0)
+			memmove(buffer.data(), buffer.data() + used, buffered);
+	}
+
+	close(fd);
+
+	// Give the remaining edges to the receiver and complete the last message
+	if(edges.size() > 0)
+		receiver.ProcessEdges(edges.data(), edges.size());
+	edges.clear();
+	receiver.Flush(time / 1000);
+	return std::string();
+}
+
+// This parses a single line (without line ending). Returns False when the line is invalid.
+bool OokReader::ParseLine(const char* line, const char* end, RFReceiver& receiver)
+{
+	const char* p = SkipSpaces(line, end);
+	if(p == end)
+		return true;
+
+	if(*p == ';')
+	{
+		// Headers and package markers
+		p++;
+		if(StartsWith(p, end, "ook"))
+		{
+			skippackage = false;
+		}
+		else if(StartsWith(p, end, "fsk"))
+		{
+			// We only understand on-off keying
+			skippackage = true;
+		}
+		else if(StartsWith(p, end, "end"))
+		{
+			skippackage = false;
+		}
+		else if(StartsWith(p, end, "timescale"))
+		{
+			// The duration of one unit, for example "1us"
+			uint64 value;
+			p = ParseNumber(SkipSpaces(p + 9, end), end, value);
+			if((p == nullptr) || (value == 0))
+				return false;
+
+			if(StartsWith(p, end, "ns"))
+				timescale = value;
+			else if(StartsWith(p, end, "us"))
+				timescale = value * 1000;
+			else if(StartsWith(p, end, "ms"))
+				timescale = value * 1000000;
+			else
+				return false;
+		}
+
+		// Other headers are not relevant for us
+		return true;
+	}
+
+	// A high duration and the low duration after it
+	uint64 high, low;
+	p = ParseNumber(p, end, high);
+	if(p == nullptr)
+		return false;
+	p = ParseNumber(SkipSpaces(p, end), end, low);
+	if(p == nullptr)
+		return false;
+
+	if(!skippackage)
+	{
+		AddEdge(1, receiver);
+		time += high * timescale;
+		AddEdge(0, receiver);
+		time += low * timescale;
+	}
+
+	return true;
+}
+
+// This adds an edge for the receiver at the current time
+void OokReader::AddEdge(uint level, RFReceiver& receiver)
+{
+	RFReceiver::Edge edge;
+	edge.time = time / 1000;
+	edge.level = level;
+	edges.push_back(edge);
+
+	if(edges.size() == EDGE_BATCH_SIZE)
+	{
+		receiver.ProcessEdges(edges.data(), edges.size());
+		edges.clear();
+	}
+}
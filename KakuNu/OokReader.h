@@ -0,0 +1,49 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include "Tools.h"
+#include "RFReceiver.h"
+
+/*
+	This reads pulse data in the OOK text format of rtl_433 and gives the edges to an RFReceiver.
+	Every line holds the duration of a high state and the duration of the low state after it.
+	Packages of pulses start with ";ook" (or ";fsk", which are skipped) and end with ";end".
+	The file is parsed in large blocks, without allocating memory per line.
+*/
+class OokReader
+{
+private:
+
+	// Constants
+	static constexpr std::size_t READ_BUFFER_SIZE = 1 << 20;
+	static constexpr std::size_t EDGE_BATCH_SIZE = 4096;
+
+	// Edges found, waiting to be given to the receiver
+	std::vector<RFReceiver::Edge> edges;
+
+	// Parser state
+	uint64 timescale;
+	uint64 time;
+	bool skippackage;
+	uint64 linenumber;
+
+	// This parses a single line (without line ending). Returns False when the line is invalid.
+	bool ParseLine(const char* line, const char* end, RFReceiver& receiver);
+
+	// This adds an edge for the receiver
+	void AddEdge(uint level, RFReceiver& receiver);
+
+public:
+
+	// Constructor / destructor
+	OokReader();
+	virtual ~OokReader();
+
+	// This reads all pulses from the file and gives the edges to the receiver.
+	// Returns an error message or an empty string on success.
+	std::string ReadFile(const std::string& filename, RFReceiver& receiver);
+};
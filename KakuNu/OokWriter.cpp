@@ -0,0 +1,121 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include "OokWriter.h"
+
+// Constructor
+OokWriter::OokWriter() :
+	packages(0),
+	dropped(0)
+{
+}
+
+// Destructor
+OokWriter::~OokWriter()
+{
+	Close();
+}
+
+// This creates the file and writes the header.
+// Returns an error message or an empty string on success.
+std::string OokWriter::Open(const std::string& filename)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	file.open(filename, std::ios::out | std::ios::trunc);
+	if(!file.is_open())
+		return "Unable to create " + filename + ": " + strerror(errno);
+
+	// The creation time is only informative
+	char created[32];
+	time_t now = time(nullptr);
+	struct tm local;
+	localtime_r(&now, &local);
+	strftime(created, sizeof(created), "%Y-%m-%d %H:%M:%S", &local);
+
+	file << ";pulse data\n"
+		<< ";version 1\n"
+		<< ";timescale 1us\n"
+		<< ";created " << created << "\n";
+	packages = 0;
+	return std::string();
+}
+
+// This writes the times of a received message as a package of pulses
+void OokWriter::WriteMessage(const std::vector<uint16>& times)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Write(times);
+}
+
+// This adds the times of a received message to the buffer, without waiting.
+// A message which does not fit completely is dropped.
+void OokWriter::AddMessage(const std::vector<uint16>& times)
+{
+	if(((buffertimes.GetCapacity() - buffertimes.GetSize()) < times.size()) ||
+		(buffersizes.GetSize() == buffersizes.GetCapacity()))
+	{
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	for(uint16 t : times)
+		buffertimes.Push(t);
+	buffersizes.Push(times.size());
+	signal.Signal();
+}
+
+// This writes the buffered messages.
+// The signal is cleared before taking them, so that messages added meanwhile signal again.
+void OokWriter::WriteBuffered()
+{
+	signal.Clear();
+	std::lock_guard<std::mutex> lock(mutex);
+	WriteBufferedMessages();
+}
+
+// This writes the buffered messages (the mutex must be locked by the caller)
+void OokWriter::WriteBufferedMessages()
+{
+	std::size_t count;
+	while(buffersizes.Pop(count))
+	{
+		buffered.resize(count);
+		for(uint16& t : buffered)
+			buffertimes.Pop(t);
+		Write(buffered);
+	}
+}
+
+// This writes the times of a message as a package of pulses.
+// The times alternate between high and low, starting with high. The last
+// low state is the pause after the message (which is saturated).
+void OokWriter::Write(const std::vector<uint16>& times)
+{
+	if(!file.is_open())
+		return;
+
+	std::size_t pulses = (times.size() + 1) / 2;
+	file << ";ook " << pulses << " pulses\n";
+	for(std::size_t i = 0; i < times.size(); i += 2)
+	{
+		uint16 gap = ((i + 1) < times.size()) ? times[i + 1] : MAX_PULSE_US;
+		file << times[i] << " " << gap << "\n";
+	}
+	file << ";end\n";
+	packages++;
+}
+
+// This writes the buffered messages and closes the file
+void OokWriter::Close()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if(file.is_open())
+	{
+		WriteBufferedMessages();
+		file.close();
+	}
+}
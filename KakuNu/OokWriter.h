@@ -0,0 +1,82 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <atomic>
+#include "Tools.h"
+#include "RingBuffer.h"
+#include "EventSignal.h"
+
+/*
+	This writes the messages received by an RFReceiver as pulse data in the OOK text
+	format of rtl_433, so that they can be analyzed with rtl_433 and related tools.
+	Every message is written as a package of pulses. Durations are in microseconds.
+	Messages from the edge path are added to a lock-free buffer, and written by WriteBuffered
+	on another thread, so that the receiver does not wait for the file.
+*/
+class OokWriter
+{
+private:
+
+	// The file we write to
+	std::ofstream file;
+
+	// Mutex for thread synchronization
+	std::mutex mutex;
+
+	// Number of packages written
+	uint64 packages;
+
+	// Buffer of messages waiting to be written. The times of a message are added before
+	// its number of times, so that a message is complete when its number can be taken.
+	// The signal is given when a message is added.
+	static constexpr std::size_t BUFFER_TIMES = 65536;
+	static constexpr std::size_t BUFFER_MESSAGES = 1024;
+	RingBuffer<uint16, BUFFER_TIMES> buffertimes;
+	RingBuffer<std::size_t, BUFFER_MESSAGES> buffersizes;
+	EventSignal signal;
+	std::vector<uint16> buffered;
+
+	// Number of messages which did not fit in the buffer
+	std::atomic<uint64> dropped;
+
+	// This writes the times of a message (the mutex must be locked by the caller)
+	void Write(const std::vector<uint16>& times);
+
+	// This writes the buffered messages (the mutex must be locked by the caller)
+	void WriteBufferedMessages();
+
+public:
+
+	// Constructor / destructor
+	OokWriter();
+	virtual ~OokWriter();
+
+	// This creates the file and writes the header.
+	// Returns an error message or an empty string on success.
+	std::string Open(const std::string& filename);
+
+	// This writes the times of a received message as a package of pulses
+	void WriteMessage(const std::vector<uint16>& times);
+
+	// This adds the times of a received message to the buffer, without waiting.
+	// Should only be called by one thread, such as the receiver's message callback.
+	void AddMessage(const std::vector<uint16>& times);
+
+	// This writes the buffered messages. Should be called when the file descriptor
+	// becomes readable, by one thread only.
+	void WriteBuffered();
+	int GetFd() const { return signal.GetFd(); }
+
+	// This writes the buffered messages and closes the file
+	void Close();
+
+	// Getters
+	uint64 GetPackageCount() { return packages; }
+	uint64 GetDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,95 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <fstream>
+#include <sstream>
+#include <errno.h>
+#include <string.h>
+#include "ParameterFile.h"
+
+// Constructor
+ParameterFile::ParameterFile() :
+	receiverparameters(),
+	decoderwindows()
+{
+}
+
+// Destructor
+ParameterFile::~ParameterFile()
+{
+}
+
+// This reads the parameters from a file over the specified parameters.
+// Returns an error message or an empty string on success.
+std::string ParameterFile::Load(const std::string& filename, const RFReceiver::Parameters& receiver, const DecoderRegistry::Windows& windows)
+{
+	std::ifstream file(filename);
+	if(!file.is_open())
+		return "Unable to open " + filename + ": " + strerror(errno);
+
+	receiverparameters = receiver;
+	decoderwindows = windows;
+	std::string line;
+	uint linenumber = 0;
+	while(std::getline(file, line))
+	{
+		linenumber++;
+		std::size_t comment = line.find('#');
+		if(comment != std::string::npos)
+			line.erase(comment);
+
+		std::istringstream words(line);
+		std::string name;
+		std::string value;
+		std::string extra;
+		if(!(words >> name))
+			continue;
+
+		char* end = nullptr;
+		bool valid = (words >> value) && !(words >> extra);
+		unsigned long long number = valid ? strtoull(value.c_str(), &end, 10) : 0;
+		valid = valid && (*end == '\0') && (value[0] != '-') && (number <= 0xFFFFFFFF);
+		if(!valid)
+			return "Unable to read " + filename + ": invalid value on line " + std::to_string(linenumber) + ".";
+		if(!SetParameter(name, number))
+			return "Unable to read " + filename + ": unknown parameter '" + name + "' on line " + std::to_string(linenumber) + ".";
+	}
+
+	if(receiverparameters.startduration >= receiverparameters.endduration)
+		return "Unable to read " + filename + ": the start duration must be shorter than the end duration.";
+	const DecoderRegistry::Windows& w = decoderwindows;
+	if((w.minshort >= w.minmedium) || (w.minmedium >= w.minlong) || (w.minlong >= w.minpause))
+		return "Unable to read " + filename + ": the minimum timings must be in increasing order.";
+
+	return std::string();
+}
+
+// This sets a parameter by name. Returns False when there is no such parameter.
+bool ParameterFile::SetParameter(const std::string& name, uint64 value)
+{
+	uint v = static_cast<uint>(value);
+	if(name == "start-duration")
+		receiverparameters.startduration = value;
+	else if(name == "end-duration")
+		receiverparameters.endduration = value;
+	else if(name == "min-message-times")
+		receiverparameters.minmessagetimes = v;
+	else if(name == "max-edge-rate")
+		receiverparameters.maxedgerate = v;
+	else if(name == "min-plausibility")
+		receiverparameters.minplausibility = v;
+	else if(name == "min-pulse")
+		receiverparameters.minpulseduration = v;
+	else if(name == "min-short")
+		decoderwindows.minshort = v;
+	else if(name == "min-medium")
+		decoderwindows.minmedium = v;
+	else if(name == "min-long")
+		decoderwindows.minlong = v;
+	else if(name == "min-pause")
+		decoderwindows.minpause = v;
+	else
+		return false;
+	return true;
+}
@@ -0,0 +1,53 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include "Tools.h"
+#include "RFReceiver.h"
+#include "DecoderRegistry.h"
+
+/*
+	This reads the parameters of the receiver and the decoder from a file, which is read again
+	on SIGHUP to change them while receiving. Every line has the name of a parameter and its value
+	in microseconds or as a number. Anything after a # is a comment.
+
+		start-duration		Minimum duration of a high state which starts a message
+		end-duration		Minimum duration of a low state which ends a message
+		min-message-times	Minimum number of timings of a valid message
+		max-edge-rate		Edges per second above which the channel is considered noise (0 to disable)
+		min-plausibility	Percentage of plausible pulses below which the channel is considered noise
+		min-pulse			Minimum duration of a plausible pulse
+		min-short			Shortest short timing by which messages are given to the protocols
+		min-medium			Shortest medium timing
+		min-long			Shortest long timing
+		min-pause			Shortest pause
+
+	Parameters which are not in the file keep the values they are loaded over.
+*/
+class ParameterFile
+{
+private:
+
+	// The parameters read
+	RFReceiver::Parameters receiverparameters;
+	DecoderRegistry::Windows decoderwindows;
+
+	// This sets a parameter by name. Returns False when there is no such parameter.
+	bool SetParameter(const std::string& name, uint64 value);
+
+public:
+
+	// Constructor / destructor
+	ParameterFile();
+	virtual ~ParameterFile();
+
+	// This reads the parameters from a file over the specified parameters.
+	// Returns an error message or an empty string on success.
+	std::string Load(const std::string& filename, const RFReceiver::Parameters& receiver, const DecoderRegistry::Windows& windows);
+
+	// Getters
+	const RFReceiver::Parameters& GetReceiverParameters() const { return receiverparameters; }
+	const DecoderRegistry::Windows& GetDecoderWindows() const { return decoderwindows; }
+};
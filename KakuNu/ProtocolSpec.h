@@ -0,0 +1,113 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include "Tools.h"
+#include "KakuMessage.h"
+
+/*
+	Descriptions of the protocols, shared by the encoders and the decoders.
+	Everything here is known at compile time. The encoder and decoder templates are
+	instantiated with these, so their tables and thresholds are constants in the code.
+*/
+
+// A timing of a protocol with the range in which a received timing is taken as this one
+struct PulseTiming
+{
+	uint nominal;
+	uint min;
+	uint max;
+};
+
+// This makes a timing of a number of time units. A received timing is taken as this one
+// from minpercent to maxpercent of the nominal duration. A maxpercent of 0 has no upper limit.
+constexpr PulseTiming MakeTiming(uint unit, uint multiple, uint minpercent, uint maxpercent)
+{
+	return PulseTiming { unit * multiple, unit * multiple * minpercent / 100,
+		(maxpercent == 0) ? 0xFFFFFFFF : (unit * multiple * maxpercent / 100) };
+}
+
+/*
+	The self-learning KAKU protocol. See SelfLearningDecoder for a description.
+*/
+struct SelfLearningSpec
+{
+	static constexpr KakuProtocol PROTOCOL = KakuProtocol::SelfLearning;
+
+	// Timings. Anything in between the ranges is unsure and thus invalid.
+	static constexpr uint UNIT_US = 250;
+	static constexpr PulseTiming SHORT = MakeTiming(UNIT_US, 1, 40, 200);
+	static constexpr PulseTiming LONG = MakeTiming(UNIT_US, 5, 72, 144);
+	static constexpr PulseTiming EXTRALONG = MakeTiming(UNIT_US, 10, 80, 128);
+	static constexpr PulseTiming MEGALONG = MakeTiming(UNIT_US, 40, 50, 0);
+
+	// The start marker is a short high and an extralong low, the stop marker
+	// is a short high and a megalong low. A subbit is a short high and a short
+	// low (0) or a long low (1).
+	static constexpr PulseTiming START_LOW = EXTRALONG;
+	static constexpr PulseTiming STOP_LOW = MEGALONG;
+	static constexpr PulseTiming SUBBIT_LOW[2] = { SHORT, LONG };
+
+	// The subbits of every symbol, first subbit in the low bit
+	static constexpr uint SYMBOL_SUBBITS[4] = { 2, 1, 0, 3 };
+
+	// Percentage within which a timing counts towards the quality
+	static constexpr uint QUALITY_TOLERANCE = 20;
+
+	// Number of timings of a message at least
+	static constexpr uint MIN_TIMES = 64;
+};
+
+/*
+	Protocols of bits made of a T/3T or 3T/T pulse, where every symbol is made of a
+	fixed number of bits and the message ends with a sync of a short high and a long low.
+	The time unit is measured from every message, so it only needs to be in a range.
+	See PulseCodeDecoder for a description.
+*/
+
+// The old KAKU protocol of switches with code wheels: 12 trits of 2 bits
+struct TriStateSpec
+{
+	static constexpr KakuProtocol PROTOCOL = KakuProtocol::TriState;
+
+	// Timings in time units, the time unit used for sending and the range of received time units
+	static constexpr uint SHORT_UNITS = 1;
+	static constexpr uint LONG_UNITS = 3;
+	static constexpr uint SYNC_UNITS = 31;
+	static constexpr uint UNIT_US = 375;
+	static constexpr uint MIN_UNIT_US = 150;
+	static constexpr uint MAX_UNIT_US = 600;
+
+	// Layout of a message and the bits of every symbol (0, 1 and F), first bit in the low bit
+	static constexpr uint SYMBOLS = 12;
+	static constexpr uint BITS_PER_SYMBOL = 2;
+	static constexpr uint NUM_SYMBOL_VALUES = 3;
+	static constexpr uint SYMBOL_BITS[NUM_SYMBOL_VALUES] = { 0, 3, 2 };
+
+	// Percentage within which a timing counts towards the quality
+	static constexpr uint QUALITY_TOLERANCE = 20;
+};
+
+// EV1527 remotes and doorbells: 24 bits
+struct EV1527Spec
+{
+	static constexpr KakuProtocol PROTOCOL = KakuProtocol::EV1527;
+
+	// Timings in time units, the time unit used for sending and the range of received time units
+	static constexpr uint SHORT_UNITS = 1;
+	static constexpr uint LONG_UNITS = 3;
+	static constexpr uint SYNC_UNITS = 31;
+	static constexpr uint UNIT_US = 350;
+	static constexpr uint MIN_UNIT_US = 150;
+	static constexpr uint MAX_UNIT_US = 600;
+
+	// Layout of a message and the bits of every symbol
+	static constexpr uint SYMBOLS = 24;
+	static constexpr uint BITS_PER_SYMBOL = 1;
+	static constexpr uint NUM_SYMBOL_VALUES = 2;
+	static constexpr uint SYMBOL_BITS[NUM_SYMBOL_VALUES] = { 0, 1 };
+
+	// Percentage within which a timing counts towards the quality
+	static constexpr uint QUALITY_TOLERANCE = 20;
+};
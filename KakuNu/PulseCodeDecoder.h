@@ -0,0 +1,154 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <vector>
+#include <string>
+#include <array>
+#include "Tools.h"
+#include "KakuMessage.h"
+#include "ProtocolSpec.h"
+
+/*
+	'0' bit:
+	 __
+	|  |________
+
+	|--|-------|
+	 T     3T
+
+
+	'1' bit:
+	 ________
+	|        |__
+
+	|--------|-|
+	     3T    T
+
+
+	'SYNC' signal (after the symbols):
+	 __
+	|  |____________________ _ _ _ ___
+
+	|--|---------------- - - - ------|
+	 T             31T
+
+	EV1527: Every symbol is a single bit. T is 300 to 450 us, depending on the resistor of the chip.
+	The first 20 bits are the address of the remote and the last 4 bits are the buttons.
+
+	Tri-state (the old KAKU protocol of switches with code wheels, also known as Intertechno
+	or PT2262): Every symbol is a trit of 2 bits, '0' is bits 0 0, '1' is bits 1 1 and 'F' is
+	bits 0 1. The bits 1 0 are not a trit. A message has 12 trits which are packed in a
+	KakuMessage as the symbols 0, 1 and 2 (for F). T ~ 375 us for KAKU switches.
+	Switches with code wheels use the first 4 trits for the house code (A to P) and
+	the next 4 trits for the unit (1 to 16), both as 0 and F trits with the lowest bit first.
+	The last trit is F for on and 0 for off.
+
+	This decodes a protocol as described by Spec (see TriStateSpec and EV1527Spec).
+*/
+template<class Spec>
+class PulseCodeDecoder
+{
+private:
+
+	// A message has the bits of all symbols, 2 timings per bit, and a sync of 2 timings
+	static constexpr uint BITS = Spec::SYMBOLS * Spec::BITS_PER_SYMBOL;
+	static constexpr uint TIMES = BITS * 2 + 2;
+
+	// Number of time units of a bit. A timing shorter than halfway is short and a timing longer is long.
+	static constexpr uint BIT_UNITS = Spec::SHORT_UNITS + Spec::LONG_UNITS;
+	static constexpr uint THRESHOLD_UNITS = BIT_UNITS / 2;
+
+	// Symbols must fit in the 2 bits of a symbol in KakuMessage
+	static_assert((Spec::NUM_SYMBOL_VALUES > 1) && (Spec::NUM_SYMBOL_VALUES <= 4), "Unsupported number of symbol values");
+	static_assert(Spec::SYMBOLS <= KakuMessage::SYMBOLS_PER_WORD, "Message does not fit in a single word");
+	static_assert(Spec::LONG_UNITS > Spec::SHORT_UNITS, "Long timing must be longer than short timing");
+
+	// This table gives the symbol for the bits of a symbol (first bit in the low bit)
+	static constexpr uint INVALID = 0xFF;
+	typedef std::array<unsigned char, 1U << Spec::BITS_PER_SYMBOL> SymbolTable;
+	static constexpr SymbolTable MakeSymbolTable()
+	{
+		SymbolTable table = { };
+		for(uint b = 0; b < table.size(); b++)
+			table[b] = INVALID;
+		for(uint s = 0; s < Spec::NUM_SYMBOL_VALUES; s++)
+			table[Spec::SYMBOL_BITS[s]] = static_cast<unsigned char>(s);
+		return table;
+	}
+	static constexpr SymbolTable SYMBOL_TABLE = MakeSymbolTable();
+
+	// This counts a timing towards the quality when it is close to the nominal duration
+	static uint IsAccurate(uint t, uint nominal)
+	{
+		uint deviation = (t > nominal) ? (t - nominal) : (nominal - t);
+		return ((deviation * 100) <= (nominal * Spec::QUALITY_TOLERANCE)) ? 1 : 0;
+	}
+
+public:
+
+	// This decodes a message.
+	// Returns an error message or an empty string on success.
+	static std::string Decode(const std::vector<uint16>& times, KakuMessage& message)
+	{
+		if(times.size() != TIMES)
+			return "Message could not be decoded. Insufficient data received.";
+
+		// We find T from the duration of all bits
+		uint total = 0;
+		for(uint i = 0; i < (BITS * 2); i++)
+			total += times[i];
+		uint unit = total / (BITS * BIT_UNITS);
+		if((unit < Spec::MIN_UNIT_US) || (unit > Spec::MAX_UNIT_US))
+			return "Message could not be decoded. Invalid timings received.";
+
+		// Every high and low pair is a bit, of which exactly one timing is long.
+		// Meanwhile we count the timings that are close to their nominal duration.
+		uint threshold = unit * THRESHOLD_UNITS;
+		uint shortus = unit * Spec::SHORT_UNITS;
+		uint longus = unit * Spec::LONG_UNITS;
+		uint accurate = 1;
+		uint64 symbols = 0;
+		for(uint s = 0; s < Spec::SYMBOLS; s++)
+		{
+			uint bits = 0;
+			for(uint b = 0; b < Spec::BITS_PER_SYMBOL; b++)
+			{
+				uint high = times[(s * Spec::BITS_PER_SYMBOL + b) * 2];
+				uint low = times[(s * Spec::BITS_PER_SYMBOL + b) * 2 + 1];
+				bool highlong = (high > threshold);
+				if(highlong == (low > threshold))
+					return "Message could not be decoded. Invalid signals received.";
+
+				bits |= static_cast<uint>(highlong) << b;
+				accurate += IsAccurate(high, highlong ? longus : shortus);
+				accurate += IsAccurate(low, highlong ? shortus : longus);
+			}
+
+			uint symbol = SYMBOL_TABLE[bits];
+			if(symbol == INVALID)
+				return "Message could not be decoded. Invalid signals received.";
+			symbols |= static_cast<uint64>(symbol) << (s * 2);
+		}
+
+		// The sync is a short high and a pause
+		uint sync = times[BITS * 2];
+		if(sync > threshold)
+			return "Message could not be decoded. End marker not found.";
+		accurate += IsAccurate(sync, shortus);
+
+		message.symbols[0] = symbols;
+		message.symbols[1] = 0;
+		message.length = Spec::SYMBOLS;
+		message.quality = static_cast<uint>(accurate * 100 / times.size());
+		return std::string();
+	}
+
+	// Returns the number of timings of a message
+	static constexpr uint GetMessageTimes() { return TIMES; }
+};
+
+// The decoders of the pulse code protocols
+typedef PulseCodeDecoder<TriStateSpec> TriStateDecoder;
+typedef PulseCodeDecoder<EV1527Spec> EV1527Decoder;
@@ -2,10 +2,17 @@
 	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
 	This software is released under MIT license.
 */
-#include <assert.h>
 #include <iostream>
 #include <errno.h>
 #include <string.h>
+#include <chrono>
+#include <string>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
 #ifdef PIGPIO_IF2
 #include <pigpiod_if2.h>
 #else
@@ -14,9 +21,6 @@
 #include "RFReceiver.h"
 #include "MicroClock.h"
 
-// Global RFReceiver instance
-RFReceiver* rfreceiverinstance = nullptr;
-
 // Global interrupt callback
 #ifdef PIGPIO_IF2
 void RFReceiverPinChangeCallback(int pi, uint pin, uint level, uint tick, void* userdata)
@@ -33,17 +37,38 @@ RFReceiver::RFReceiver() :
 	pin(0),
 	pi(0),
 	hcallback(0),
-	startduration(DEFAULT_START_DURATION_US),
-	endduration(DEFAULT_END_DURATION_US),
-	minmessagetimes(DEFAULT_MIN_MESSAGE_TIMES),
+	ingestion(Ingestion::Callback),
+	hnotify(-1),
+	chippath(DEFAULT_GPIO_CHIP),
+	readfd(-1),
+	stopfd(-1),
+	readerthread(nullptr),
+	latesttime(0),
+	parameters(Parameters { DEFAULT_START_DURATION_US, DEFAULT_END_DURATION_US, DEFAULT_MIN_MESSAGE_TIMES,
+		DEFAULT_MAX_EDGE_RATE, DEFAULT_MIN_PLAUSIBILITY, DEFAULT_MIN_PULSE_DURATION_US }),
 	starttime(0),
 	lasttime(0),
-	laststate(0)
+	lasttick(0),
+	laststate(0),
+	synced(false),
+	glitchduration(DEFAULT_GLITCH_DURATION_US),
+	softwarefilter(false),
+	pending(false),
+	pendinglevel(0),
+	pendingtick(0),
+	hunting(false),
+	windowduration(0),
+	windowedges(0),
+	windowplausible(0),
+	huntrun(0),
+	recordcost(0),
+	huntcost(0),
+	costsamplecounter(0),
+	codematcher(nullptr),
+	matched(false),
+	matchedtimes(0),
+	stats()
 {
-	// Make sure we are a singleton instance
-	assert(rfreceiverinstance == nullptr);
-	rfreceiverinstance = this;
-
 	// Allocate memory for timings
 	times.reserve(MAX_MESSAGE_TIMES);
 }
@@ -51,7 +76,29 @@ RFReceiver::RFReceiver() :
 // Destructor
 RFReceiver::~RFReceiver()
 {
-	rfreceiverinstance = nullptr;
+}
+
+// This resets the state for receiving from a new source.
+// The mutex must be locked by the caller.
+void RFReceiver::Reset()
+{
+	times.clear();
+	starttime = 0;
+	lasttime = 0;
+	lasttick = 0;
+	laststate = 0;
+	synced = false;
+	hunting = false;
+	windowduration = 0;
+	windowedges = 0;
+	windowplausible = 0;
+	huntrun = 0;
+	pending = false;
+	pendinglevel = 0;
+	pendingtick = 0;
+	matched = false;
+	matchedtimes = 0;
+	softwarefilter = (glitchduration > 0);
 }
 
 // This starts receiving on the specified pin
@@ -60,29 +107,441 @@ void RFReceiver::Start(int pidevice, int inputpin)
 	std::lock_guard<std::mutex> lock(mutex);
 	pi = pidevice;
 	pin = inputpin;
-	
-	// Setup listening interrupt on input pin
+	Reset();
+
+	// Glitches are best removed by pigpio, before they reach us. This works for notifications
+	// and for callbacks on pigpiod, but not for the ISR callback we use with pigpio directly.
+	// When pigpio can't do it, we filter the glitches ourselves.
 	#ifdef PIGPIO_IF2
-		hcallback = callback_ex(pi, pin, EITHER_EDGE, &RFReceiverPinChangeCallback, reinterpret_cast<void*>(this));
-		if(hcallback < 0)
-			std::cout << "Error setting up RFReceiverPinChangeCallback interrupt: " << strerror(errno) << std::endl;
+		bool canfilter = (ingestion != Ingestion::GpioChip);
 	#else
-		if(gpioSetISRFuncEx(pin, EITHER_EDGE, 0, &RFReceiverPinChangeCallback, reinterpret_cast<void*>(this)) != 0)
-			std::cout << "Error setting up RFReceiverPinChangeCallback interrupt: " << strerror(errno) << std::endl;
+		bool canfilter = (ingestion == Ingestion::Notify);
 	#endif
+	if(softwarefilter && canfilter)
+	{
+		#ifdef PIGPIO_IF2
+			int result = set_glitch_filter(pi, static_cast<uint>(pin), glitchduration);
+		#else
+			int result = gpioGlitchFilter(static_cast<uint>(pin), glitchduration);
+		#endif
+		if(result == 0)
+			softwarefilter = false;
+		else
+			std::cout << "Error setting up glitch filter, using software filter instead." << std::endl;
+	}
+
+	switch(ingestion)
+	{
+		case Ingestion::Notify:
+			StartNotifications();
+			break;
+
+		case Ingestion::GpioChip:
+			StartGpioChip();
+			break;
+
+		case Ingestion::Offline:
+			// Edges are given to ProcessEdges
+			break;
+
+		case Ingestion::Callback:
+			// Setup listening interrupt on input pin
+			#ifdef PIGPIO_IF2
+				hcallback = callback_ex(pi, pin, EITHER_EDGE, &RFReceiverPinChangeCallback, reinterpret_cast<void*>(this));
+				if(hcallback < 0)
+					std::cout << "Error setting up RFReceiverPinChangeCallback interrupt: " << strerror(errno) << std::endl;
+			#else
+				if(gpioSetISRFuncEx(pin, EITHER_EDGE, 0, &RFReceiverPinChangeCallback, reinterpret_cast<void*>(this)) != 0)
+					std::cout << "Error setting up RFReceiverPinChangeCallback interrupt: " << strerror(errno) << std::endl;
+			#endif
+			break;
+	}
 }
 
-// Stops the receiver
-void RFReceiver::Stop()
+// This starts receiving line events from the specified file descriptor. This is normally a
+// line request on a GPIO chip, but anything that produces gpio_v2_line_event structures will do.
+// The receiver takes ownership of the file descriptor.
+void RFReceiver::StartLineEvents(int linefd)
 {
 	std::lock_guard<std::mutex> lock(mutex);
+	ingestion = Ingestion::GpioChip;
+	Reset();
+	StartReader(linefd);
+}
+
+// This starts receiving edges given to ProcessEdges
+void RFReceiver::StartOffline()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	ingestion = Ingestion::Offline;
+	Reset();
+}
+
+// This handles a batch of state changes (only for Ingestion::Offline).
+// The edges must be in chronological order.
+void RFReceiver::ProcessEdges(const Edge* edges, std::size_t count)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.batches++;
+
+	for(std::size_t i = 0; i < count; i++)
+	{
+		// The lower 32 bits of the time serve as tick
+		latesttime = edges[i].time;
+		FilterEdge(edges[i].level, static_cast<uint>(latesttime));
+
+		// We are the consumer of the edge buffer as well, so we empty it before it overflows
+		if(edgebuffer.GetSize() == edgebuffer.GetCapacity())
+			DeliverEdges();
+	}
+
+	DeliverEdges();
+}
+
+// This completes the message being received as if the state did not change until the specified time.
+// This is used at the end of a recording, where no more state changes will come.
+void RFReceiver::Flush(uint64 time)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// A pending state change has been stable until now
+	if(pending)
+	{
+		pending = false;
+		HandleEdge(pendinglevel, pendingtick);
+	}
+
+	// End the last state with a state change at the specified time
+	latesttime = time;
+	HandleEdge((laststate > 0) ? 0 : 1, static_cast<uint>(time));
+}
+
+// This opens a pigpio notification pipe for the pin and starts the thread which reads it.
+// The mutex must be locked by the caller.
+void RFReceiver::StartNotifications()
+{
+	#ifdef PIGPIO_IF2
+		hnotify = notify_open(pi);
+	#else
+		hnotify = gpioNotifyOpen();
+	#endif
+	if(hnotify < 0)
+	{
+		std::cout << "Error opening pigpio notification: " << strerror(errno) << std::endl;
+		return;
+	}
+
+	// pigpio writes the reports to a named pipe with the handle number.
+	// Start reading before pigpio starts writing, so that the pipe never fills up.
+	std::string pipename = "/dev/pigpio" + std::to_string(hnotify);
+	int fd = open(pipename.c_str(), O_RDONLY | O_NONBLOCK);
+	if(fd < 0)
+	{
+		std::cout << "Error opening " << pipename << ": " << strerror(errno) << std::endl;
+		StopReader();
+		return;
+	}
+	StartReader(fd);
 
-	// Clean up
 	#ifdef PIGPIO_IF2
-		callback_cancel(static_cast<uint>(hcallback));
+		int result = notify_begin(pi, static_cast<uint>(hnotify), 1u << pin);
 	#else
-		gpioSetISRFuncEx(pin, EITHER_EDGE, 0, nullptr, nullptr);
+		int result = gpioNotifyBegin(static_cast<uint>(hnotify), 1u << pin);
 	#endif
+	if(result != 0)
+		std::cout << "Error starting pigpio notification: " << strerror(errno) << std::endl;
+}
+
+// This requests the pin as an input line with edge detection on the GPIO chip
+// and starts the thread which reads its events.
+// The mutex must be locked by the caller.
+void RFReceiver::StartGpioChip()
+{
+	int chipfd = open(chippath.c_str(), O_RDONLY | O_CLOEXEC);
+	if(chipfd < 0)
+	{
+		std::cout << "Error opening " << chippath << ": " << strerror(errno) << std::endl;
+		return;
+	}
+
+	// The kernel timestamps the edges for us (CLOCK_MONOTONIC) and keeps them in a
+	// buffer until we read them. The buffer is made large enough for a few messages.
+	gpio_v2_line_request request;
+	memset(&request, 0, sizeof(request));
+	request.offsets[0] = static_cast<__u32>(pin);
+	request.num_lines = 1;
+	request.event_buffer_size = LINE_EVENT_BUFFER_SIZE;
+	request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+	strncpy(request.consumer, "kakunu", sizeof(request.consumer) - 1);
+	int result = ioctl(chipfd, GPIO_V2_GET_LINE_IOCTL, &request);
+	close(chipfd);
+	if(result < 0)
+	{
+		std::cout << "Error requesting line " << pin << " on " << chippath << ": " << strerror(errno) << std::endl;
+		return;
+	}
+
+	StartReader(request.fd);
+}
+
+// This starts the thread which reads the specified file descriptor.
+// The mutex must be locked by the caller.
+void RFReceiver::StartReader(int fd)
+{
+	readfd = fd;
+	stopfd = eventfd(0, 0);
+	if(stopfd < 0)
+	{
+		std::cout << "Error creating eventfd: " << strerror(errno) << std::endl;
+		return;
+	}
+
+	readerthread = new std::thread(&RFReceiver::ReaderThread, this);
+}
+
+// This stops the reader thread and closes what it was reading.
+// The mutex must NOT be locked by the caller, because the thread needs it to finish.
+void RFReceiver::StopReader()
+{
+	if(readerthread != nullptr)
+	{
+		uint64 value = 1;
+		if(write(stopfd, &value, sizeof(value)) != sizeof(value))
+			std::cout << "Error stopping reader thread: " << strerror(errno) << std::endl;
+		readerthread->join();
+		delete readerthread;
+		readerthread = nullptr;
+	}
+
+	if(hnotify >= 0)
+	{
+		#ifdef PIGPIO_IF2
+			notify_close(pi, static_cast<uint>(hnotify));
+		#else
+			gpioNotifyClose(static_cast<uint>(hnotify));
+		#endif
+		hnotify = -1;
+	}
+
+	if(readfd >= 0)
+		close(readfd);
+	if(stopfd >= 0)
+		close(stopfd);
+	readfd = -1;
+	stopfd = -1;
+}
+
+// Stops the receiver
+void RFReceiver::Stop()
+{
+	// The reader thread must be stopped before we take the lock
+	if((ingestion == Ingestion::Notify) || (ingestion == Ingestion::GpioChip))
+		StopReader();
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Clean up
+	if(ingestion == Ingestion::Callback)
+	{
+		#ifdef PIGPIO_IF2
+			callback_cancel(static_cast<uint>(hcallback));
+		#else
+			gpioSetISRFuncEx(pin, EITHER_EDGE, 0, nullptr, nullptr);
+		#endif
+	}
+
+	if((glitchduration > 0) && !softwarefilter)
+	{
+		#ifdef PIGPIO_IF2
+			set_glitch_filter(pi, static_cast<uint>(pin), 0);
+		#else
+			gpioGlitchFilter(static_cast<uint>(pin), 0);
+		#endif
+	}
+
+	// Give the last state changes to the recorder
+	DeliverEdges();
+}
+
+// This gives the buffered state changes to the edge callback.
+// The signal is cleared before taking them, so that state changes added meanwhile signal again.
+void RFReceiver::DeliverEdges()
+{
+	edgesignal.Clear();
+
+	RawEdge raw;
+	while(edgebuffer.Pop(raw))
+	{
+		Edge edge;
+		edge.time = ConvertTick(raw.tick);
+		edge.level = raw.level;
+		edgecallback(edge);
+	}
+}
+
+// This is the thread that reads pigpio notifications or line events.
+// These are read in batches as large as the file has available
+// and each batch is handled with a single lock.
+void RFReceiver::ReaderThread()
+{
+	alignas(8) char buffer[READ_BUFFER_SIZE];
+	size_t buffered = 0;
+	size_t recordsize = (ingestion == Ingestion::Notify) ? sizeof(gpioReport_t) : sizeof(gpio_v2_line_event);
+
+	pollfd fds[2];
+	fds[0].fd = readfd;
+	fds[0].events = POLLIN;
+	fds[1].fd = stopfd;
+	fds[1].events = POLLIN;
+
+	while(true)
+	{
+		// Wait for data or a request to stop
+		if(poll(fds, 2, -1) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			std::cout << "Error waiting for state changes: " << strerror(errno) << std::endl;
+			return;
+		}
+
+		if(fds[1].revents != 0)
+			return;
+
+		// Read as much as is available
+		ssize_t count = read(readfd, buffer + buffered, sizeof(buffer) - buffered);
+		if(count < 0)
+		{
+			if((errno == EINTR) || (errno == EAGAIN))
+				continue;
+
+			std::cout << "Error reading state changes: " << strerror(errno) << std::endl;
+			return;
+		}
+		else if(count == 0)
+		{
+			// The other end closed the file
+			return;
+		}
+
+		buffered += static_cast<size_t>(count);
+		size_t numrecords = buffered / recordsize;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.batches++;
+
+			if(ingestion == Ingestion::Notify)
+			{
+				const gpioReport_t* reports = reinterpret_cast<const gpioReport_t*>(buffer);
+				for(size_t i = 0; i < numrecords; i++)
+				{
+					// Skip reports that are not about a level change
+					const gpioReport_t& r = reports[i];
+					if((r.flags & (PI_NTFY_FLAGS_EVENT | PI_NTFY_FLAGS_ALIVE | PI_NTFY_FLAGS_WDOG)) != 0)
+						continue;
+
+					FilterEdge((r.level >> pin) & 1, r.tick);
+				}
+			}
+			else
+			{
+				const gpio_v2_line_event* events = reinterpret_cast<const gpio_v2_line_event*>(buffer);
+				for(size_t i = 0; i < numrecords; i++)
+				{
+					// The lower 32 bits of the timestamp in microseconds serve as tick
+					latesttime = events[i].timestamp_ns / 1000;
+					uint level = (events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE) ? 1 : 0;
+					FilterEdge(level, static_cast<uint>(latesttime));
+				}
+			}
+		}
+
+		// Keep the part of a record that was not complete yet
+		size_t used = numrecords * recordsize;
+		buffered -= used;
+		if(buffered > 0)
+			memmove(buffer, buffer + used, buffered);
+	}
+}
+
+// This converts a tick to absolute time in microseconds.
+// The tick must be in the past (within the last 71 minutes).
+// This is also called by DeliverEdges without the mutex, for ticks of edges which have
+// passed through the edge buffer.
+uint64 RFReceiver::ConvertTick(uint tick) const
+{
+	// Kernel and offline timestamps are absolute already, we only dropped the upper bits
+	if((ingestion == Ingestion::GpioChip) || (ingestion == Ingestion::Offline))
+	{
+		uint64 latest = latesttime.load(std::memory_order_relaxed);
+		return latest - static_cast<uint>(static_cast<uint>(latest) - tick);
+	}
+
+	return microclock.ConvertTime(tick);
+}
+
+// Sets the minimum duration of a high state which starts a message.
+// The setters publish a new set of parameters with the one parameter changed.
+void RFReceiver::SetStartMessageDuration(uint64 microseconds)
+{
+	Parameters params = parameters.Get();
+	params.startduration = microseconds;
+	parameters.Publish(params);
+}
+
+// Sets the minimum duration of a low state which ends a message
+void RFReceiver::SetEndMessageDuration(uint64 microseconds)
+{
+	Parameters params = parameters.Get();
+	params.endduration = microseconds;
+	parameters.Publish(params);
+}
+
+// Sets the minimum number of timings of a valid message
+void RFReceiver::SetMinMessageTimes(uint minimumtimes)
+{
+	Parameters params = parameters.Get();
+	params.minmessagetimes = minimumtimes;
+	parameters.Publish(params);
+}
+
+// Sets the edges per second above which the channel is considered noise
+void RFReceiver::SetMaxEdgeRate(uint edgespersecond)
+{
+	Parameters params = parameters.Get();
+	params.maxedgerate = edgespersecond;
+	parameters.Publish(params);
+}
+
+// Sets the percentage of plausible pulses below which the channel is considered noise
+void RFReceiver::SetMinPlausibility(uint percent)
+{
+	Parameters params = parameters.Get();
+	params.minplausibility = percent;
+	parameters.Publish(params);
+}
+
+// Sets the minimum duration of a plausible pulse
+void RFReceiver::SetMinPulseDuration(uint microseconds)
+{
+	Parameters params = parameters.Get();
+	params.minpulseduration = microseconds;
+	parameters.Publish(params);
+}
+
+// Returns a snapshot of the counters
+RFReceiver::Statistics RFReceiver::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	Statistics result = stats;
+
+	// Every edge skipped while hunting saved us the difference in cost
+	if(recordcost > huntcost)
+		result.savedtime = stats.huntededges * (recordcost - huntcost) / 1000;
+
+	return result;
 }
 
 // Interrupt callback when pin state changes.
@@ -91,16 +550,193 @@ void RFReceiver::Stop()
 void RFReceiver::PinChangeCallback(uint level, uint tick)
 {
 	std::lock_guard<std::mutex> lock(mutex);
+	FilterEdge(level, tick);
+}
 
+// This removes duplicate state changes and glitches before handling a state change.
+// The mutex must be locked by the caller.
+void RFReceiver::FilterEdge(uint level, uint tick)
+{
 	// This is all about a change of state. If I get this interrupt for the same state twice,
 	// then someone (pigpio programmer or raspbian programmer) fucked up his logic and that's
 	// why I have to put this check here. I am disappointed.
-	if(level == laststate)
+	if(level == (pending ? pendinglevel : laststate))
 		return;
 
-	// Convert the time to our time in microseconds since the start of the clock.
-	uint64 time = microclock.ConvertTime(tick);
+	stats.edges++;
+
+	// Buffer the state change for the recorder before it is filtered.
+	// The consumer converts the tick and writes it, so that we don't wait for either here.
+	if(edgecallback != nullptr)
+	{
+		if(!edgebuffer.Push(RawEdge { tick, level }))
+			stats.droppededges++;
+		else if(edgebuffer.GetSize() >= EDGE_SIGNAL_COUNT)
+			edgesignal.Signal();
+	}
+
+	// Without the software glitch filter, every change is handled immediately
+	if(!softwarefilter)
+	{
+		HandleEdge(level, tick);
+		return;
+	}
+
+	// With the software glitch filter, a change is only handled once the state has been stable
+	// for the glitch duration. When the state changes back sooner, both changes are dropped,
+	// which merges the glitch and the pulse after it into the pulse before it.
+	if(pending)
+	{
+		pending = false;
+		if((tick - pendingtick) < glitchduration)
+		{
+			stats.glitches++;
+			return;
+		}
+
+		HandleEdge(pendinglevel, pendingtick);
+	}
+
+	pending = true;
+	pendinglevel = level;
+	pendingtick = tick;
+}
+
+// This handles a state change which passed the filters.
+// The mutex must be locked by the caller.
+void RFReceiver::HandleEdge(uint level, uint tick)
+{
+	// Once in a while we measure how long it takes to handle an edge
+	bool measure = (++costsamplecounter == COST_SAMPLE_INTERVAL);
+	std::chrono::steady_clock::time_point measurestart;
+	if(measure)
+	{
+		costsamplecounter = 0;
+		measurestart = std::chrono::steady_clock::now();
+	}
+
+	// Duration of the previous state in microseconds.
+	// The unsigned subtraction also works when the tick wraps around to 0.
+	uint duration = tick - lasttick;
+	lasttick = tick;
+
+	// The parameters are taken once for the edge, so that a new set published
+	// meanwhile does not mix with the old one
+	const Parameters& params = parameters.Get();
+
+	if(UpdateGovernor(level, duration, params))
+	{
+		// We are hunting for a preamble, so nothing is recorded.
+		// We also stop keeping time and ask the clock again when we stop hunting.
+		stats.huntededges++;
+		synced = false;
+	}
+	else
+	{
+		// Determine the time in microseconds since the start of the clock.
+		// Only after we lost track of time, we have to ask the clock to convert the tick.
+		// The tick is 32 bits and wraps after about 71 minutes, so a long silence may be
+		// shorter than it really was. After every silence that ends a message we ask the clock
+		// again, which costs one conversion per message and keeps the time right.
+		uint64 time;
+		if(synced && (duration < params.endduration))
+		{
+			time = lasttime + duration;
+		}
+		else
+		{
+			time = ConvertTick(tick);
+			synced = true;
+		}
+
+		RecordEdge(level, time, duration, params);
+		lasttime = time;
+	}
+
+	laststate = level;
+
+	if(measure)
+	{
+		// Keep a running average of the cost, in nanoseconds
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - measurestart);
+		uint64& cost = hunting ? huntcost : recordcost;
+		cost = (cost * 7 + static_cast<uint64>(elapsed.count())) / 8;
+	}
+}
 
+// This updates the noise governor with a new pulse and returns True when we should be hunting.
+// The pulse is the state before the given level and lasted for the specified duration.
+bool RFReceiver::UpdateGovernor(uint level, uint duration, const Parameters& params)
+{
+	bool plausible = (duration >= params.minpulseduration);
+
+	// Collect statistics over the current window.
+	// Long silences count up to the window duration, so that they don't overflow.
+	windowedges++;
+	if(plausible)
+		windowplausible++;
+	windowduration += (duration < GOVERNOR_WINDOW_US) ? duration : GOVERNOR_WINDOW_US;
+
+	if(windowduration >= GOVERNOR_WINDOW_US)
+	{
+		// Judge the channel over this window
+		uint64 maxedges = static_cast<uint64>(params.maxedgerate) * windowduration / 1000000;
+		bool toofast = (params.maxedgerate > 0) && (windowedges > maxedges);
+		bool implausible = (static_cast<uint64>(windowplausible) * 100) < (static_cast<uint64>(params.minplausibility) * windowedges);
+		bool noisy = toofast || implausible;
+
+		if(noisy && !hunting)
+		{
+			// Forget about the message we were recording, it is drowned in noise
+			hunting = true;
+			huntrun = 0;
+			stats.huntentries++;
+			times.clear();
+			starttime = 0;
+		}
+		else if(!noisy && hunting)
+		{
+			hunting = false;
+		}
+
+		windowduration = 0;
+		windowedges = 0;
+		windowplausible = 0;
+	}
+
+	if(hunting)
+	{
+		// A falling edge after a high state that is long enough would
+		// normally start a message, but we ignore that while hunting.
+		if((level == 0) && (duration >= params.startduration) && (duration < params.endduration))
+			stats.rejectedstarts++;
+
+		// A number of plausible pulses in a row is taken as a preamble.
+		// We then start recording again at the next message start.
+		if(plausible && (duration < params.endduration))
+			huntrun++;
+		else
+			huntrun = 0;
+
+		// A silence as long as the end of a message means the noise has stopped.
+		// We start recording right away, because this edge may start a message.
+		if((huntrun >= HUNT_PREAMBLE_PULSES) || (duration >= params.endduration))
+		{
+			hunting = false;
+			windowduration = 0;
+			windowedges = 0;
+			windowplausible = 0;
+		}
+	}
+
+	return hunting;
+}
+
+// This records a state change in the current message.
+// The time is the absolute time of the state change and the duration is the
+// time in microseconds since the previous state change.
+void RFReceiver::RecordEdge(uint level, uint64 time, uint duration, const Parameters& params)
+{
 	// If we are looking for the start of a new message...
 	if(times.size() == 0)
 	{
@@ -113,10 +749,12 @@ void RFReceiver::PinChangeCallback(uint level, uint tick)
 		else if((starttime > 0) && (level == 0))
 		{
 			// First falling edge must be a minimum duration from the first rising edge
-			if(((time - starttime) >= startduration) && ((time - starttime) < endduration))
+			if(((time - starttime) >= params.startduration) && ((time - starttime) < params.endduration))
 			{
 				// Potential message start. Start keeping times.
-				times.push_back(static_cast<uint>(time - starttime));
+				times.push_back(SaturatePulse(time - starttime));
+				matched = false;
+				MatchTime();
 			}
 			else
 			{
@@ -134,17 +772,26 @@ void RFReceiver::PinChangeCallback(uint level, uint tick)
 	else
 	{
 		// Add the time to the list
-		times.push_back(static_cast<uint>(time - lasttime));
+		times.push_back(SaturatePulse(duration));
+		MatchTime();
 
 		// If there was a long time since the last change,
 		// or the max number of message times has been reached,
 		// then we should start with a new message.
-		if(((time - lasttime) > endduration) || (times.size() == MAX_MESSAGE_TIMES))
+		if((duration > params.endduration) || (times.size() == MAX_MESSAGE_TIMES))
 		{
 			// If this message looks legit, then invoke the callback!
-			if(times.size() >= minmessagetimes)
+			// A known code has been handled already, but when the message has another
+			// length than that code, it only began like it and must be decoded.
+			if(matched && (times.size() == matchedtimes))
 			{
-				if(msgcallback != nullptr)
+				stats.matchedcodes++;
+			}
+			else
+			{
+				if(matched)
+					stats.mismatchedcodes++;
+				if((times.size() >= params.minmessagetimes) && (msgcallback != nullptr))
 					msgcallback(times, starttime);
 			}
 
@@ -156,8 +803,25 @@ void RFReceiver::PinChangeCallback(uint level, uint tick)
 				starttime = 0;
 		}
 	}
+}
 
-	// Note the last time and state
-	lasttime = time;
-	laststate = level;
+// This compares the newest timing of the current message with the known codes.
+// A code is handed to the callback as soon as it matches, without waiting for the end of the message.
+void RFReceiver::MatchTime()
+{
+	if((codematcher == nullptr) || matched)
+		return;
+
+	int code = codematcher->Match(matchstate, static_cast<uint>(times.size() - 1), times.back());
+	if(code >= 0)
+	{
+		matched = true;
+		matchedtimes = codematcher->GetMessageTimes(static_cast<uint>(code));
+		if(codecallback != nullptr)
+		{
+			KakuMessage msg = codematcher->GetCode(static_cast<uint>(code));
+			msg.time = starttime;
+			codecallback(msg);
+		}
+	}
 }
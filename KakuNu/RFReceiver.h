@@ -4,19 +4,147 @@
 */
 #pragma once
 #include <vector>
+#include <atomic>
 #include <mutex>
+#include <thread>
+#include <functional>
+#include <string>
 #include "Tools.h"
+#include "RcuPointer.h"
+#include "RingBuffer.h"
+#include "EventSignal.h"
+#include "KakuMessage.h"
+#include "CodeMatcher.h"
 
 class RFReceiver
 {
+public:
+
+	// How state changes are received from pigpio
+	enum class Ingestion : int
+	{
+		// A callback for every state change
+		Callback = 0,
+
+		// Batches of reports read from a pigpio notification pipe
+		Notify = 1,
+
+		// Batches of line events read from the Linux GPIO character device.
+		// This does not need pigpio and the edges are timestamped by the kernel.
+		GpioChip = 2,
+
+		// Batches of edges given to ProcessEdges, for example from a recording
+		Offline = 3
+	};
+
+	// A state change with its absolute time in microseconds
+	struct Edge
+	{
+		uint64 time;
+		uint level;
+	};
+
+	// Parameters which can be changed while receiving.
+	// A new set is published as a whole and taken for the next edge.
+	struct Parameters
+	{
+		// Minimum duration of a high state which indicates the start of a message, in microseconds.
+		uint64 startduration;
+
+		// Minimum duration of a low state which indicates the end of a message, in microseconds.
+		uint64 endduration;
+
+		// Minimum number of timings to record before we consider it a valid message.
+		uint minmessagetimes;
+
+		// Noise governor settings.
+		// When more than maxedgerate edges per second arrive, or less than minplausibility
+		// percent of the pulses are at least minpulseduration long, the channel is considered
+		// noise and we only hunt for a preamble, without converting times or recording them.
+		uint maxedgerate;
+		uint minplausibility;
+		uint minpulseduration;
+
+		// Comparison, so that publishing the same parameters again does nothing
+		bool operator==(const Parameters& other) const
+		{
+			return (startduration == other.startduration) && (endduration == other.endduration) &&
+				(minmessagetimes == other.minmessagetimes) && (maxedgerate == other.maxedgerate) &&
+				(minplausibility == other.minplausibility) && (minpulseduration == other.minpulseduration);
+		}
+	};
+
+	// Counters for the edges handled by the receiver
+	struct Statistics
+	{
+		// Number of state changes received
+		uint64 edges;
+
+		// Number of batches read from the notification pipe or GPIO chip
+		uint64 batches;
+
+		// Number of glitches removed by the software glitch filter
+		uint64 glitches;
+
+		// Number of state changes that were skipped while hunting for a preamble
+		uint64 huntededges;
+
+		// Number of times the receiver switched to hunting because of noise
+		uint64 huntentries;
+
+		// Number of plausible message starts that were ignored while hunting.
+		// This is the upper limit for the number of messages falsely rejected.
+		uint64 rejectedstarts;
+
+		// Estimated processing time saved by hunting instead of recording, in microseconds
+		uint64 savedtime;
+
+		// Number of messages recognized as a known code, which were not given to the message callback
+		uint64 matchedcodes;
+
+		// Number of messages which matched a known code, but were of a different length.
+		// These were given to the message callback as well.
+		uint64 mismatchedcodes;
+
+		// Number of state changes not given to the edge callback, because its buffer was full
+		uint64 droppededges;
+	};
+
 private:
 
+	// A state change as it arrives, waiting to be given to the edge callback
+	struct RawEdge
+	{
+		uint tick;
+		uint level;
+	};
+
 	// Constants
 	// The defaults are good for the 2019 kaku dimmer protocol
 	const std::size_t MAX_MESSAGE_TIMES = 200;
 	const uint64 DEFAULT_START_DURATION_US = 200;
 	const uint64 DEFAULT_END_DURATION_US = 5000;
 	const uint DEFAULT_MIN_MESSAGE_TIMES = 64;
+	const uint DEFAULT_GLITCH_DURATION_US = 50;
+	const char* DEFAULT_GPIO_CHIP = "/dev/gpiochip0";
+	const uint LINE_EVENT_BUFFER_SIZE = 1024;
+	static constexpr std::size_t READ_BUFFER_SIZE = 12288;
+
+	// State changes for the edge callback are buffered, and the consumer is woken up
+	// when this many are waiting. It should also take them periodically (see DeliverEdges).
+	static constexpr std::size_t EDGE_BUFFER_SIZE = 16384;
+	const std::size_t EDGE_SIGNAL_COUNT = 1024;
+
+	// Noise governor constants
+	// The channel is judged on windows of this duration.
+	// While hunting, this many plausible pulses in a row are taken as a preamble.
+	// The cost of handling an edge is measured once every COST_SAMPLE_INTERVAL edges.
+	const uint GOVERNOR_WINDOW_US = 50000;
+	const uint DEFAULT_MAX_EDGE_RATE = 8000;
+	const uint DEFAULT_MIN_PLAUSIBILITY = 75;
+	const uint DEFAULT_MIN_PULSE_DURATION_US = 100;
+	const uint HUNT_PREAMBLE_PULSES = 8;
+	const uint COST_SAMPLE_INTERVAL = 256;
 
 	// The input pin on which to listen
 	int pin;
@@ -25,32 +153,127 @@ private:
 	int pi;
 	int hcallback;
 
+	// How we receive state changes
+	Ingestion ingestion;
+
+	// Handle of the pigpio notification (only used for Ingestion::Notify)
+	int hnotify;
+
+	// Path of the GPIO chip device (only used for Ingestion::GpioChip)
+	std::string chippath;
+
+	// File we read in batches and the thread that reads it
+	// (used for Ingestion::Notify and Ingestion::GpioChip).
+	int readfd;
+	int stopfd;
+	std::thread* readerthread;
+
+	// Absolute time in microseconds of the newest edge
+	// (only used for Ingestion::GpioChip and Ingestion::Offline).
+	// This is atomic, because DeliverEdges converts ticks with it on another thread.
+	std::atomic<uint64> latesttime;
+
 	// Mutex for thread synchronization
 	std::mutex mutex;
 
 	// Delta times of received state changes in microseconds.
 	// The first item is the duration of the first high state.
-	std::vector<uint> times;
-
-	// Minimum duration of a high state which indicates the start of a message, in microseconds.
-	uint64 startduration;
+	// Durations longer than MAX_PULSE_US are saturated.
+	std::vector<uint16> times;
 
-	// Minimum duration of a low state which indicates the end of a message, in microseconds.
-	uint64 endduration;
-
-	// Minimum number of timings to record before we consider it a valid message.
-	uint minmessagetimes;
+	// The parameters, which the edges are handled with (see Parameters)
+	RcuPointer<Parameters> parameters;
 
 	// Absolute time in microseconds of the first rising edge
 	// for the current message being received.
 	uint64 starttime;
 
-	// Absolute time and state of the most recently received state change.
+	// Absolute time, tick and state of the most recently received state change.
+	// The absolute time is kept by adding the elapsed ticks, so that we only need
+	// to ask the clock when we have lost track of time (see 'synced') and after a silence
+	// as long as the end of a message, in which the tick may have wrapped around.
 	uint64 lasttime;
+	uint lasttick;
 	uint laststate;
+	bool synced;
+
+	// Glitch filter.
+	// States shorter than glitchduration are merged into the surrounding states. When the
+	// filter is done in software, a state change is pending until it has been stable long enough.
+	uint glitchduration;
+	bool softwarefilter;
+	bool pending;
+	uint pendinglevel;
+	uint pendingtick;
+
+	// Noise governor state
+	bool hunting;
+	uint windowduration;
+	uint windowedges;
+	uint windowplausible;
+	uint huntrun;
+
+	// Measured cost of handling an edge while recording and while hunting, in nanoseconds
+	uint64 recordcost;
+	uint64 huntcost;
+	uint costsamplecounter;
+
+	// Known codes to recognize while receiving.
+	// When a message matches, it is not given to the message callback at its end,
+	// unless it turns out longer or shorter than the code it matched (matchedtimes).
+	const CodeMatcher* codematcher;
+	CodeMatcher::State matchstate;
+	bool matched;
+	std::size_t matchedtimes;
+
+	// Counters
+	Statistics stats;
 
 	// Callback to invoke when a message has been received.
-	std::function<void(const std::vector<uint>&, uint64)> msgcallback;
+	std::function<void(const std::vector<uint16>&, uint64)> msgcallback;
+
+	// Callback to invoke for every state change received (before the filters).
+	// The state changes are only buffered on the edge path and the callback is invoked
+	// by DeliverEdges on the thread of the consumer, so that it can do I/O.
+	std::function<void(const Edge&)> edgecallback;
+	RingBuffer<RawEdge, EDGE_BUFFER_SIZE> edgebuffer;
+	EventSignal edgesignal;
+
+	// Callback to invoke when a known code has been recognized.
+	// This is called on the edge path, so it must not do any I/O or wait.
+	std::function<void(const KakuMessage&)> codecallback;
+
+	// This resets the state for receiving from a new source
+	void Reset();
+
+	// This starts reading the pigpio notification pipe or the GPIO chip
+	void StartNotifications();
+	void StartGpioChip();
+
+	// This starts and stops the thread which reads a file in batches
+	void StartReader(int fd);
+	void StopReader();
+
+	// This is the thread that reads pigpio notifications or line events
+	void ReaderThread();
+
+	// This converts a tick to absolute time in microseconds
+	uint64 ConvertTick(uint tick) const;
+
+	// This removes duplicate state changes and glitches before handling a state change
+	void FilterEdge(uint level, uint tick);
+
+	// This handles a state change which passed the filters
+	void HandleEdge(uint level, uint tick);
+
+	// This updates the noise governor with a new pulse and returns True when we should be hunting.
+	bool UpdateGovernor(uint level, uint duration, const Parameters& params);
+
+	// This records a state change in the current message
+	void RecordEdge(uint level, uint64 time, uint duration, const Parameters& params);
+
+	// This compares the newest timing of the current message with the known codes
+	void MatchTime();
 
 public:
 
@@ -61,17 +284,53 @@ public:
 	// This starts receiving on the specified pin
 	void Start(int pidevice, int inputpin);
 
+	// This starts receiving line events from the specified file descriptor
+	void StartLineEvents(int linefd);
+
+	// This starts receiving edges given to ProcessEdges
+	void StartOffline();
+
+	// This handles a batch of state changes (only for Ingestion::Offline)
+	void ProcessEdges(const Edge* edges, std::size_t count);
+
+	// This completes the message being received as if the state did not change until the specified time
+	void Flush(uint64 time);
+
 	// Stops the receiver
 	void Stop();
 
+	// This gives the buffered state changes to the edge callback.
+	// Should be called by one thread only, when the edge file descriptor becomes readable and
+	// periodically, because it is only signalled when many state changes are waiting.
+	// With Ingestion::Offline this is done by ProcessEdges.
+	void DeliverEdges();
+	int GetEdgeFd() const { return edgesignal.GetFd(); }
+
 	// Getters / setters
-	void SetStartMessageDuration(uint64 microseconds) { startduration = microseconds; }
-	uint64 GetStartMessageDuration() { return startduration; }
-	void SetEndMessageDuration(uint64 microseconds) { endduration = microseconds; }
-	uint64 GetEndMessageDuration() { return endduration; }
-	void SetMinMessageTimes(uint minimumtimes) { minmessagetimes = minimumtimes; }
-	uint GetMinMessageTimes() { return minmessagetimes; }
-	void SetMessageCallback(std::function<void(const std::vector<uint>&, uint64)> f) { msgcallback = f; }
+	void SetParameters(const Parameters& params) { parameters.Publish(params); }
+	const Parameters& GetParameters() const { return parameters.Get(); }
+	void SetStartMessageDuration(uint64 microseconds);
+	uint64 GetStartMessageDuration() { return parameters.Get().startduration; }
+	void SetEndMessageDuration(uint64 microseconds);
+	uint64 GetEndMessageDuration() { return parameters.Get().endduration; }
+	void SetMinMessageTimes(uint minimumtimes);
+	uint GetMinMessageTimes() { return parameters.Get().minmessagetimes; }
+	void SetMaxEdgeRate(uint edgespersecond);
+	uint GetMaxEdgeRate() { return parameters.Get().maxedgerate; }
+	void SetMinPlausibility(uint percent);
+	uint GetMinPlausibility() { return parameters.Get().minplausibility; }
+	void SetMinPulseDuration(uint microseconds);
+	uint GetMinPulseDuration() { return parameters.Get().minpulseduration; }
+	void SetIngestion(Ingestion mode) { ingestion = mode; }
+	Ingestion GetIngestion() { return ingestion; }
+	void SetGpioChip(const std::string& path) { chippath = path; }
+	const std::string& GetGpioChip() { return chippath; }
+	void SetGlitchDuration(uint microseconds) { glitchduration = microseconds; }
+	uint GetGlitchDuration() { return glitchduration; }
+	void SetMessageCallback(std::function<void(const std::vector<uint16>&, uint64)> f) { msgcallback = f; }
+	void SetEdgeCallback(std::function<void(const Edge&)> f) { edgecallback = f; }
+	void SetCodeMatcher(const CodeMatcher* matcher, std::function<void(const KakuMessage&)> f) { codematcher = matcher; codecallback = f; }
+	Statistics GetStatistics();
 
 	// Interrupt callback when pin state changes.
 	// Should not be called by users, only by the global RFReceiverPinChangeCallback().
@@ -0,0 +1,80 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+/*
+	A value which is read by one or more threads and replaced now and then by another,
+	in the manner of read-copy-update. A new value is copied into a new version and the
+	pointer to it is swapped, so readers never wait and always see a complete version.
+	A reader should get the value once for a unit of work (such as an edge or a message).
+
+	We don't track readers, so a replaced version is kept for a grace period, which is much
+	longer than a reader holds a version. It is deleted at the first publish after that.
+	Publishing a value equal to the current version does not make a new version.
+	The value type must be copyable and comparable with ==.
+*/
+template<class T>
+class RcuPointer final
+{
+private:
+
+	// Constants
+	static constexpr std::chrono::milliseconds GRACE_PERIOD = std::chrono::milliseconds(10000);
+
+	// A replaced version and when it was replaced
+	struct Retired
+	{
+		std::unique_ptr<const T> version;
+		std::chrono::steady_clock::time_point time;
+	};
+
+	// The version readers get
+	std::atomic<const T*> current;
+
+	// The current version and the replaced versions in their grace period, oldest first.
+	// These are only used by writers.
+	std::unique_ptr<const T> owned;
+	std::deque<Retired> retired;
+	std::mutex writemutex;
+
+public:
+
+	// Constructor
+	RcuPointer(const T& value) : current(nullptr), owned(new T(value))
+	{
+		current.store(owned.get(), std::memory_order_release);
+	}
+
+	// Not copyable, because readers point into the versions
+	RcuPointer(const RcuPointer&) = delete;
+	RcuPointer& operator=(const RcuPointer&) = delete;
+
+	// Returns the current version (can be called from any thread)
+	const T& Get() const { return *current.load(std::memory_order_acquire); }
+
+	// This makes a new version of the value, which readers get from now on
+	void Publish(const T& value)
+	{
+		std::lock_guard<std::mutex> lock(writemutex);
+		if(*owned == value)
+			return;
+
+		// Delete the versions which were replaced longer than the grace period ago
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		while(!retired.empty() && ((now - retired.front().time) >= GRACE_PERIOD))
+			retired.pop_front();
+
+		// Replace the current version
+		std::unique_ptr<const T> version(new T(value));
+		current.store(version.get(), std::memory_order_release);
+		retired.push_back(Retired { std::move(owned), now });
+		owned = std::move(version);
+	}
+};
@@ -0,0 +1,230 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <errno.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <queue>
+#include <thread>
+#include "Replayer.h"
+#include "KakuDecoder.h"
+
+// Constructor
+Replayer::Replayer() :
+	addressfilter(nullptr),
+	codematcher(nullptr),
+	codecorrector(nullptr)
+{
+}
+
+// Destructor
+Replayer::~Replayer()
+{
+}
+
+// This adds a file to decode. When the path is a directory, all files in it are added.
+// Returns an error message or an empty string on success.
+std::string Replayer::AddPath(const std::string& path)
+{
+	struct stat info;
+	if(stat(path.c_str(), &info) != 0)
+		return "Unable to open " + path + ": " + strerror(errno);
+
+	if(!S_ISDIR(info.st_mode))
+	{
+		files.push_back(path);
+		return std::string();
+	}
+
+	DIR* dir = opendir(path.c_str());
+	if(dir == nullptr)
+		return "Unable to open " + path + ": " + strerror(errno);
+
+	// Add the regular files in the directory, sorted by name
+	std::vector<std::string> names;
+	while(struct dirent* entry = readdir(dir))
+	{
+		std::string filename = path + "/" + entry->d_name;
+		if((stat(filename.c_str(), &info) == 0) && S_ISREG(info.st_mode))
+			names.push_back(filename);
+	}
+	closedir(dir);
+
+	std::sort(names.begin(), names.end());
+	files.insert(files.end(), names.begin(), names.end());
+	return std::string();
+}
+
+// This decodes all files with the specified number of worker threads.
+// Only messages that begin in the specified time range are kept.
+void Replayer::Run(std::size_t numworkers, uint64 begin, uint64 end)
+{
+	// Split the files in tasks
+	reports.assign(files.size(), FileReport());
+	tasks.clear();
+	std::vector<uint64> tasksizes;
+	for(std::size_t f = 0; f < files.size(); f++)
+	{
+		struct stat info;
+		reports[f].filename = files[f];
+		reports[f].bytes = (stat(files[f].c_str(), &info) == 0) ? static_cast<uint64>(info.st_size) : 0;
+
+		std::vector<Part> parts;
+		if(partitioner != nullptr)
+			parts = partitioner(files[f], begin, end);
+		else
+			parts.push_back(Part { begin, end });
+
+		for(const Part& part : parts)
+		{
+			Task task;
+			task.file = f;
+			task.part = part;
+			task.errors = 0;
+			task.seconds = 0.0;
+			tasks.push_back(task);
+			tasksizes.push_back(reports[f].bytes / parts.size());
+		}
+	}
+
+	// Deal the tasks to the workers, largest first, so that the
+	// small tasks are left at the end to even out the work.
+	numworkers = std::max<std::size_t>(1, std::min(numworkers, tasks.size()));
+	queues = std::vector<WorkQueue>(numworkers);
+	std::vector<std::size_t> order(tasks.size());
+	for(std::size_t i = 0; i < tasks.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&tasksizes](std::size_t a, std::size_t b)
+	{
+		return tasksizes[a] > tasksizes[b];
+	});
+	for(std::size_t i = 0; i < order.size(); i++)
+		queues[i % numworkers].tasks.push_back(order[i]);
+
+	// Run the workers
+	std::vector<std::thread> workers;
+	for(std::size_t w = 0; w < numworkers; w++)
+		workers.push_back(std::thread(std::bind(&Replayer::WorkerThread, this, w)));
+	for(std::thread& t : workers)
+		t.join();
+
+	// Add up the results of the tasks for every file
+	for(const Task& task : tasks)
+	{
+		FileReport& report = reports[task.file];
+		report.messages += task.results.size();
+		report.errors += task.errors;
+		report.seconds += task.seconds;
+		if(report.error.size() == 0)
+			report.error = task.error;
+	}
+}
+
+// This takes a task for the specified worker. Returns False when there is no work left.
+// Tasks are taken from the front of our own queue or stolen from the back of another.
+bool Replayer::TakeTask(std::size_t worker, std::size_t& task)
+{
+	for(std::size_t i = 0; i < queues.size(); i++)
+	{
+		WorkQueue& queue = queues[(worker + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(queue.tasks.size() > 0)
+		{
+			if(i == 0)
+			{
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+			}
+			else
+			{
+				task = queue.tasks.back();
+				queue.tasks.pop_back();
+			}
+			return true;
+		}
+	}
+
+	// No new tasks are made while running, so all work has been taken
+	return false;
+}
+
+// This is the thread of a worker
+void Replayer::WorkerThread(std::size_t worker)
+{
+	// Messages are decoded on this thread, so the decoder needs no thread of its own
+	RFReceiver receiver;
+	KakuDecoder decoder(false);
+	decoder.SetCodeCorrector(codecorrector);
+	decoder.SetAddressFilter(addressfilter);
+	if(receiversetup != nullptr)
+		receiversetup(receiver);
+	receiver.SetMinMessageTimes(decoder.GetMinMessageTimes());
+
+	std::size_t t;
+	while(TakeTask(worker, t))
+	{
+		// Only decode the messages that begin in the part, because the reader may give the
+		// edges around the part as well. Messages are decoded right away on this thread.
+		Task& task = tasks[t];
+		receiver.SetMessageCallback([&task, &decoder](const std::vector<uint16>& times, uint64 starttime)
+		{
+			if((starttime >= task.part.begin) && (starttime < task.part.end))
+				decoder.DecodeMessageNow(times, starttime);
+		});
+		decoder.SetResultCallback([&task](const KakuMessage& msg) { task.results.push_back(msg); });
+		if(codematcher != nullptr)
+		{
+			receiver.SetCodeMatcher(codematcher, [&task, &decoder](const KakuMessage& msg)
+			{
+				if((msg.time >= task.part.begin) && (msg.time < task.part.end))
+					decoder.AddKnownCodeNow(msg);
+			});
+		}
+		decoder.SetErrorCallback([&task](const std::string&) { task.errors++; });
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		receiver.StartOffline();
+		task.error = filereader(files[task.file], task.part, receiver);
+		task.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+// This returns the results of all files in order of time.
+// The results of every task are already in order, so these are merged.
+// Messages at the same time are ordered by file.
+std::vector<Replayer::Result> Replayer::GetResults() const
+{
+	typedef std::pair<uint64, std::pair<std::size_t, std::size_t>> Head;
+	std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+	std::size_t total = 0;
+	for(std::size_t t = 0; t < tasks.size(); t++)
+	{
+		total += tasks[t].results.size();
+		if(tasks[t].results.size() > 0)
+			heads.push(Head(tasks[t].results[0].time, std::make_pair(t, 0)));
+	}
+
+	std::vector<Result> results;
+	results.reserve(total);
+	while(!heads.empty())
+	{
+		std::size_t t = heads.top().second.first;
+		std::size_t i = heads.top().second.second;
+		const Task& task = tasks[t];
+		heads.pop();
+
+		Result result;
+		result.file = task.file;
+		result.message = task.results[i];
+		results.push_back(result);
+
+		if((i + 1) < task.results.size())
+			heads.push(Head(task.results[i + 1].time, std::make_pair(t, i + 1)));
+	}
+
+	return results;
+}
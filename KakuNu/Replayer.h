@@ -0,0 +1,142 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include "Tools.h"
+#include "KakuMessage.h"
+#include "RFReceiver.h"
+#include "AddressFilter.h"
+#include "CodeMatcher.h"
+#include "CodeCorrector.h"
+
+/*
+	This decodes many recordings in parallel. Every file is split in one or more parts and every
+	part is a task. Every worker thread has its own queue of tasks, with its own RFReceiver and
+	KakuDecoder. A worker which has no more tasks steals them from the back of the queues of
+	other workers. The results of all files are merged in order of time.
+*/
+class Replayer
+{
+public:
+
+	// A message decoded from one of the files
+	struct Result
+	{
+		// Index of the file in the list of files
+		std::size_t file;
+
+		// The decoded message
+		KakuMessage message;
+	};
+
+	// A part of a file to decode. Only messages that begin in this time range are kept.
+	struct Part
+	{
+		uint64 begin;
+		uint64 end;
+	};
+
+	// Report of the decoding of a single file
+	struct FileReport
+	{
+		std::string filename;
+		uint64 bytes;
+		uint64 messages;
+		uint64 errors;
+
+		// Time it took to decode the file (all parts together), in seconds
+		double seconds;
+
+		// Error reading the file, or empty when the file was read successfully
+		std::string error;
+	};
+
+private:
+
+	// A part of a file to decode, with its results
+	struct Task
+	{
+		std::size_t file;
+		Part part;
+		uint64 errors;
+		double seconds;
+		std::string error;
+
+		// Decoded messages (in order of time)
+		std::vector<KakuMessage> results;
+	};
+
+	// Tasks of a worker
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<std::size_t> tasks;
+	};
+
+	// Files to decode and their reports
+	std::vector<std::string> files;
+	std::vector<FileReport> reports;
+
+	// All tasks and the task queues (one for each worker)
+	std::vector<Task> tasks;
+	std::vector<WorkQueue> queues;
+
+	// Function to set up the receiver of a worker
+	std::function<void(RFReceiver&)> receiversetup;
+
+	// Filter for the decoded messages of all workers
+	AddressFilter* addressfilter;
+
+	// Known codes which every worker recognizes while receiving
+	const CodeMatcher* codematcher;
+
+	// Corrector for the decoded messages of all workers
+	CodeCorrector* codecorrector;
+
+	// Function to split a file in parts. Without it, every file is a single part.
+	std::function<std::vector<Part>(const std::string&, uint64, uint64)> partitioner;
+
+	// Function to read (a part of) a file and give its edges to a receiver.
+	// Returns an error message or an empty string on success.
+	std::function<std::string(const std::string&, const Part&, RFReceiver&)> filereader;
+
+	// This takes a task for the specified worker. Returns False when there is no work left.
+	bool TakeTask(std::size_t worker, std::size_t& task);
+
+	// This is the thread of a worker
+	void WorkerThread(std::size_t worker);
+
+public:
+
+	// Constructor / destructor
+	Replayer();
+	virtual ~Replayer();
+
+	// This adds a file to decode. When the path is a directory, all files in it are added.
+	// Returns an error message or an empty string on success.
+	std::string AddPath(const std::string& path);
+
+	// This decodes all files with the specified number of worker threads.
+	// Only messages that begin in the specified time range are kept.
+	void Run(std::size_t numworkers, uint64 begin, uint64 end);
+
+	// This returns the results of all files in order of time
+	std::vector<Result> GetResults() const;
+
+	// Getters / setters
+	void SetReceiverSetup(std::function<void(RFReceiver&)> f) { receiversetup = f; }
+	void SetAddressFilter(AddressFilter* filter) { addressfilter = filter; }
+	void SetCodeMatcher(const CodeMatcher* matcher) { codematcher = matcher; }
+	void SetCodeCorrector(CodeCorrector* corrector) { codecorrector = corrector; }
+	void SetPartitioner(std::function<std::vector<Part>(const std::string&, uint64, uint64)> f) { partitioner = f; }
+	void SetFileReader(std::function<std::string(const std::string&, const Part&, RFReceiver&)> f) { filereader = f; }
+	const std::vector<FileReport>& GetReports() const { return reports; }
+	std::size_t GetFileCount() const { return files.size(); }
+	std::size_t GetTaskCount() const { return tasks.size(); }
+};
@@ -0,0 +1,74 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+/*
+	A bounded lock-free queue for a single producer thread and a single consumer thread.
+	Items are copied into a fixed array, so pushing never allocates or blocks.
+	The positions only ever increase and are wrapped when indexing the array.
+*/
+template<class T, std::size_t CAPACITY>
+class RingBuffer final
+{
+private:
+
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of 2");
+
+	// Constants
+	static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+	// The items
+	T items[CAPACITY];
+
+	// Position of the next item to push (written by the producer only) and
+	// of the next item to pop (written by the consumer only).
+	// These are on separate cache lines, so that the threads don't slow each other down.
+	alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head;
+	alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail;
+
+public:
+
+	// Constructor
+	RingBuffer() : head(0), tail(0) { }
+
+	// This adds an item (only to be called by the producer).
+	// Returns False when the buffer is full.
+	bool Push(const T& item)
+	{
+		std::size_t h = head.load(std::memory_order_relaxed);
+		if((h - tail.load(std::memory_order_acquire)) == CAPACITY)
+			return false;
+
+		items[h & (CAPACITY - 1)] = item;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// This takes the oldest item (only to be called by the consumer).
+	// Returns False when the buffer is empty.
+	bool Pop(T& item)
+	{
+		std::size_t t = tail.load(std::memory_order_relaxed);
+		if(t == head.load(std::memory_order_acquire))
+			return false;
+
+		item = items[t & (CAPACITY - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns the number of items in the buffer (can be called from any thread)
+	std::size_t GetSize() const
+	{
+		// The tail is read first, because it can never pass the head
+		std::size_t t = tail.load(std::memory_order_acquire);
+		return head.load(std::memory_order_acquire) - t;
+	}
+
+	// Returns the maximum number of items in the buffer
+	static constexpr std::size_t GetCapacity() { return CAPACITY; }
+};
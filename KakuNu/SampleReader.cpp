@@ -0,0 +1,175 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "SampleReader.h"
+
+// Vector of 16 samples, which the compiler maps to NEON or SSE2 instructions
+typedef unsigned char SampleVector __attribute__((vector_size(16)));
+
+// Constructor
+SampleReader::SampleReader() :
+	format(Format::Packed1Bit),
+	samplerate(DEFAULT_SAMPLE_RATE),
+	threshold(DEFAULT_THRESHOLD),
+	level(0)
+{
+	edges.reserve(EDGE_BATCH_SIZE);
+}
+
+// Destructor
+SampleReader::~SampleReader()
+{
+}
+
+// This reads all samples from the file and gives the edges to the receiver.
+// Returns an error message or an empty string on success.
+std::string SampleReader::ReadFile(const std::string& filename, RFReceiver& receiver)
+{
+	if(samplerate == 0)
+		return "Unable to read samples. Invalid sample rate.";
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		return "Unable to open " + filename + ": " + strerror(errno);
+
+	// The buffer always holds a multiple of 64 samples, except at the end of the file
+	const std::size_t blocksize = (format == Format::Packed1Bit) ? sizeof(uint64) : 64;
+	std::vector<unsigned char> buffer(READ_BUFFER_SIZE);
+	std::size_t buffered = 0;
+	uint64 index = 0;
+	level = 0;
+	edges.clear();
+
+	while(true)
+	{
+		ssize_t count = read(fd, buffer.data() + buffered, buffer.size() - buffered);
+		if(count < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			std::string error = "Unable to read " + filename + ": " + strerror(errno);
+			close(fd);
+			return error;
+		}
+
+		buffered += static_cast<std::size_t>(count);
+		bool endoffile = (count == 0);
+
+		// Process all whole blocks of 64 samples
+		std::size_t used = 0;
+		for(; (used + blocksize) <= buffered; used += blocksize, index += 64)
+		{
+			uint64 samples;
+			if(format == Format::Packed1Bit)
+				memcpy(&samples, buffer.data() + used, sizeof(samples));
+			else
+				samples = PackSamples(buffer.data() + used);
+
+			FindEdges(samples, index, 64, receiver);
+		}
+
+		if(endoffile)
+		{
+			// Process the samples that do not make a whole block
+			uint64 samples = 0;
+			uint numsamples = 0;
+			for(std::size_t i = used; i < buffered; i++)
+			{
+				if(format == Format::Packed1Bit)
+				{
+					samples |= static_cast<uint64>(buffer[i]) << (numsamples);
+					numsamples += 8;
+				}
+				else
+				{
+					samples |= static_cast<uint64>(buffer[i] >= threshold) << numsamples;
+					numsamples++;
+				}
+			}
+			FindEdges(samples, index, numsamples, receiver);
+			index += numsamples;
+			break;
+		}
+
+		// Keep the incomplete block for the next read
+		buffered -= used;
+		if(buffered > 0)
+			memmove(buffer.data(), buffer.data() + used, buffered);
+	}
+
+	close(fd);
+
+	// Give the remaining edges to the receiver and complete the last message
+	if(edges.size() > 0)
+		receiver.ProcessEdges(edges.data(), edges.size());
+	edges.clear();
+	receiver.Flush(index * 1000000 / samplerate);
+	return std::string();
+}
+
+// This converts 64 samples of 8 bits to 64 samples of 1 bit.
+// The samples are compared to the threshold 16 at a time and the results (0x00 or 0xFF)
+// are gathered into bits with a multiplication, 8 at a time.
+uint64 SampleReader::PackSamples(const unsigned char* samples) const
+{
+	SampleVector thresholds;
+	for(int i = 0; i < 16; i++)
+		thresholds[i] = static_cast<unsigned char>(threshold);
+
+	uint64 result = 0;
+	for(uint v = 0; v < 4; v++)
+	{
+		SampleVector vec;
+		memcpy(&vec, samples + v * 16, sizeof(vec));
+		SampleVector high = reinterpret_cast<SampleVector>(vec >= thresholds);
+
+		uint64 halves[2];
+		memcpy(halves, &high, sizeof(halves));
+		for(uint h = 0; h < 2; h++)
+		{
+			uint64 bits = ((halves[h] & 0x8080808080808080ULL) * 0x0002040810204081ULL) >> 56;
+			result |= bits << (v * 16 + h * 8);
+		}
+	}
+
+	return result;
+}
+
+// This finds the edges in 64 samples of 1 bit, starting at the specified sample index.
+// Only the first 'count' samples are used.
+void SampleReader::FindEdges(uint64 samples, uint64 index, uint count, RFReceiver& receiver)
+{
+	if(count == 0)
+		return;
+
+	// A sample differs from the sample before it where this has a bit set
+	uint64 changes = samples ^ ((samples << 1) | level);
+	if(count < 64)
+		changes &= (1ULL << count) - 1;
+
+	level = static_cast<uint>(samples >> (count - 1)) & 1;
+
+	// Most blocks have no edges at all
+	while(changes != 0)
+	{
+		uint bit = static_cast<uint>(__builtin_ctzll(changes));
+		changes &= changes - 1;
+
+		RFReceiver::Edge edge;
+		edge.time = (index + bit) * 1000000 / samplerate;
+		edge.level = static_cast<uint>(samples >> bit) & 1;
+		edges.push_back(edge);
+
+		if(edges.size() == EDGE_BATCH_SIZE)
+		{
+			receiver.ProcessEdges(edges.data(), edges.size());
+			edges.clear();
+		}
+	}
+}
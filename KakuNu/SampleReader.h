@@ -0,0 +1,76 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <algorithm>
+#include <vector>
+#include "Tools.h"
+#include "RFReceiver.h"
+
+/*
+	This reads a recording of fixed rate level samples (as made with SDR or logic analyzer tools),
+	finds the edges in it and gives them to an RFReceiver in batches.
+*/
+class SampleReader
+{
+public:
+
+	// Sample formats
+	enum class Format : int
+	{
+		// 8 samples per byte, the first sample in the lowest bit
+		Packed1Bit = 0,
+
+		// 1 sample per byte, high when the value is at least the threshold
+		Bytes8Bit = 1
+	};
+
+private:
+
+	// Constants
+	static constexpr std::size_t READ_BUFFER_SIZE = 1 << 20;
+	static constexpr std::size_t EDGE_BATCH_SIZE = 4096;
+	const uint64 DEFAULT_SAMPLE_RATE = 1000000;
+	const uint DEFAULT_THRESHOLD = 1;
+
+	// Highest threshold an 8 bit sample can reach. Higher thresholds are clamped to this,
+	// so that the vectorized and the scalar comparison agree.
+	static constexpr uint MAX_THRESHOLD = 255;
+
+	// Settings
+	Format format;
+	uint64 samplerate;
+	uint threshold;
+
+	// Edges found, waiting to be given to the receiver
+	std::vector<RFReceiver::Edge> edges;
+
+	// Level of the last sample processed
+	uint level;
+
+	// This converts 64 samples of 8 bits to 64 samples of 1 bit
+	uint64 PackSamples(const unsigned char* samples) const;
+
+	// This finds the edges in 64 samples of 1 bit, starting at the specified sample index
+	void FindEdges(uint64 samples, uint64 index, uint count, RFReceiver& receiver);
+
+public:
+
+	// Constructor / destructor
+	SampleReader();
+	virtual ~SampleReader();
+
+	// This reads all samples from the file and gives the edges to the receiver.
+	// Returns an error message or an empty string on success.
+	std::string ReadFile(const std::string& filename, RFReceiver& receiver);
+
+	// Getters / setters
+	void SetFormat(Format f) { format = f; }
+	Format GetFormat() { return format; }
+	void SetSampleRate(uint64 samplespersecond) { samplerate = samplespersecond; }
+	uint64 GetSampleRate() { return samplerate; }
+	void SetThreshold(uint value) { threshold = std::min(value, MAX_THRESHOLD); }
+	uint GetThreshold() { return threshold; }
+};
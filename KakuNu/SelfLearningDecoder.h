@@ -0,0 +1,230 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <vector>
+#include <string>
+#include "Tools.h"
+#include "KakuMessage.h"
+#include "ProtocolSpec.h"
+
+/*
+	'0' subbit:
+	 __
+	|  |___
+
+	|--|--|
+	 T  T
+
+
+	'1' subbit:
+	 __
+	|  |______________
+
+	|--|-------------|
+	 T       5T
+
+
+	'START' signal:
+	 __
+	|  |________________________________
+
+	|--|-------------------------------|
+	 T              10T
+
+
+	'STOP' signal:
+	 __
+	|  |________________________________ _ _ _ _____
+
+	|--|-------------------------------- - - - ----|
+	 T                      40T
+
+	T ~ 250 us (Short)
+	5T ~ 1250 us (Long)
+	10T ~ 2500 us (ExtraLong)
+	40T ~ 10 ms (MegaLong)
+
+	Bit encoding: 0 bit = subbits 0 1
+	              1 bit = subbits 1 0
+	For example, the bits 0111 are encoded as 01101010.
+	The extended protocol for dimmers contains additional bit combinations:
+				  2 bit = subbits 0 0
+				  3 bit = subbits 1 1
+
+	This decodes the self-learning protocol as described by Spec (see SelfLearningSpec).
+*/
+template<class Spec>
+class SelfLearningDecoder
+{
+private:
+
+	// Coding scheme for timings
+	enum class Timecode : int
+	{
+		Short = 0,
+		Long = 1,
+		ExtraLong = 2,
+		MegaLong = 3
+	};
+
+	// Subbits are collected in a bitstream with 64 subbits per word.
+	// Each word converts to exactly one word of packed symbols.
+	static constexpr uint SUBBITS_PER_WORD = 64;
+	static constexpr uint MAX_SUBBITS = KakuMessage::MAX_SYMBOLS * 2;
+
+	// This returns the symbol for a pair of subbits (first in the low bit, second in the high bit)
+	// by inverting the high bit when the low bit is 0, which is done for many pairs at once below.
+	static constexpr uint PairToSymbol(uint pair) { return pair ^ ((~pair & 1) << 1); }
+
+	// The symbol map of the protocol must be the one we decode
+	static constexpr bool MatchesSymbolMap()
+	{
+		for(uint s = 0; s < 4; s++)
+		{
+			if(PairToSymbol(Spec::SYMBOL_SUBBITS[s]) != s)
+				return false;
+		}
+		return true;
+	}
+	static_assert(MatchesSymbolMap(), "The subbits of the symbols can not be decoded");
+
+	// This returns True when the timing is in the range
+	static bool IsTiming(uint t, const PulseTiming& timing) { return (t >= timing.min) && (t <= timing.max); }
+
+	// This counts a timing towards the quality when it is close to the nominal duration
+	static uint IsAccurate(uint t, const PulseTiming& timing)
+	{
+		uint deviation = (t > timing.nominal) ? (t - timing.nominal) : (timing.nominal - t);
+		return ((deviation * 100) <= (timing.nominal * Spec::QUALITY_TOLERANCE)) ? 1 : 0;
+	}
+
+public:
+
+	// This decodes a message.
+	// Returns an error message or an empty string on success.
+	static std::string Decode(const std::vector<uint16>& times, KakuMessage& message)
+	{
+		// Check if we have received a minimum number of times to allow parsing
+		if(times.size() < 6)
+			return "Message could not be decoded. Insufficient data received.";
+
+		// First change the times into a code scheme which is easier to process.
+		// Meanwhile we count the timings that are close to their nominal duration.
+		// The timecodes are kept for every thread, so that only the first messages allocate.
+		thread_local std::vector<Timecode> timecodes;
+		timecodes.clear();
+		timecodes.reserve(times.size());
+		uint accurate = 0;
+		for(uint16 t : times)
+		{
+			if(IsTiming(t, Spec::SHORT))
+			{
+				timecodes.push_back(Timecode::Short);
+				accurate += IsAccurate(t, Spec::SHORT);
+			}
+			else if(IsTiming(t, Spec::LONG))
+			{
+				timecodes.push_back(Timecode::Long);
+				accurate += IsAccurate(t, Spec::LONG);
+			}
+			else if(IsTiming(t, Spec::EXTRALONG))
+			{
+				timecodes.push_back(Timecode::ExtraLong);
+				accurate += IsAccurate(t, Spec::EXTRALONG);
+			}
+			else if(IsTiming(t, Spec::MEGALONG))
+			{
+				// A pause has no nominal duration
+				timecodes.push_back(Timecode::MegaLong);
+				accurate++;
+			}
+			else
+			{
+				return "Message could not be decoded. Invalid timings received.";
+			}
+		}
+
+		// Find the start of the message.
+		// This consists of a short high and an extralong low. Because the timecodes are alternating high and low signals,
+		// we scan through these with a step size of 2 so that 'i' is always at a high signal.
+		size_t startindex = 0;
+		for(size_t i = 0; i < (timecodes.size() - 2); i += 2)
+		{
+			if((timecodes[i] == Timecode::Short) && (timecodes[i + 1] == Timecode::ExtraLong))
+			{
+				startindex = i + 2;
+				break;
+			}
+		}
+
+		// The message never starts at index 0, because the start marker
+		// (right before the actual message) is 2 signals long.
+		if(startindex == 0)
+			return "Message could not be decoded. Start marker not found.";
+
+		// Parse the timecodes into subbits.
+		// Again, we do this in steps of 2 signals (a high and a low) because
+		// all subbits and the end marker come in pairs. The subbits are collected
+		// in a bitstream, subbit n is stored in bit n%64 of word n/64.
+		bool endmarkerfound = false;
+		uint64 subbits[MAX_SUBBITS / SUBBITS_PER_WORD] = { };
+		uint numsubbits = 0;
+		for(size_t i = startindex; i < (timecodes.size() - 1); i += 2)
+		{
+			Timecode t1 = timecodes[i];
+			Timecode t2 = timecodes[i + 1];
+
+			if((t1 == Timecode::Short) && (t2 == Timecode::MegaLong))
+			{
+				endmarkerfound = true;
+				break;
+			}
+			else if((t1 != Timecode::Short) || ((t2 != Timecode::Short) && (t2 != Timecode::Long)))
+			{
+				return "Message could not be decoded. Invalid signals received.";
+			}
+			else if(numsubbits == MAX_SUBBITS)
+			{
+				return "Message could not be decoded. Message is too long.";
+			}
+
+			// A short low is a 0 subbit and a long low is a 1 subbit
+			subbits[numsubbits / SUBBITS_PER_WORD] |= static_cast<uint64>(t2 == Timecode::Long) << (numsubbits % SUBBITS_PER_WORD);
+			numsubbits++;
+		}
+
+		// Check if the end marker is actually received.
+		if(!endmarkerfound)
+			return "Message could not be decoded. End marker not found.";
+
+		// Pair the subbits into symbols (see PairToSymbol):
+		//   0 1 -> binary 10 -> 00 (0)
+		//   1 0 -> binary 01 -> 01 (1)
+		//   0 0 -> binary 00 -> 10 (2)
+		//   1 1 -> binary 11 -> 11 (3)
+		// This converts 32 pairs per word at once. An odd subbit at the end is ignored.
+		message.length = numsubbits / 2;
+		message.quality = static_cast<uint>(accurate * 100 / times.size());
+		for(uint w = 0; w < KakuMessage::NUM_WORDS; w++)
+		{
+			uint64 sb = subbits[w];
+			uint64 symbols = sb ^ ((~sb & 0x5555555555555555ULL) << 1);
+
+			// Clear the symbols beyond the end of the message
+			uint first = w * KakuMessage::SYMBOLS_PER_WORD;
+			if(message.length <= first)
+				symbols = 0;
+			else if((message.length - first) < KakuMessage::SYMBOLS_PER_WORD)
+				symbols &= (1ULL << ((message.length - first) * 2)) - 1;
+
+			message.symbols[w] = symbols;
+		}
+
+		return std::string();
+	}
+};
+
+// The decoder of the self-learning KAKU protocol
+typedef SelfLearningDecoder<SelfLearningSpec> KakuSelfLearningDecoder;
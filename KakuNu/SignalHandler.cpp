@@ -3,81 +3,84 @@
 	This software is released under MIT license.
 */
 #include <iostream>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
 #include <pthread.h>
 #include <signal.h>
+#include <sys/signalfd.h>
 #include "SignalHandler.h"
 
 // Constructor
 SignalHandler::SignalHandler() :
+	fd(-1),
 	exitsignal(false),
-	thread(nullptr)
+	statssignal(false),
+	reloadonhangup(false),
+	reloadsignal(false)
 {
 	sigset_t signal_set;
 	
 	// Block all signals for the current (main) thread.
 	// This must be done before ANY threads are created,
 	// so that all threads inherit these settings.
+	// The signals are then only delivered through the signalfd.
 	sigfillset(&signal_set);
 	pthread_sigmask(SIG_BLOCK, &signal_set, NULL);
 
-	// Create a separate thread to handle signals
-	thread = new std::thread(&SignalHandler::Thread, this);
+	fd = signalfd(-1, &signal_set, SFD_NONBLOCK | SFD_CLOEXEC);
+	if(fd < 0)
+		std::cout << "Error creating signalfd: " << strerror(errno) << std::endl;
 }
 
 // Destructor
 SignalHandler::~SignalHandler()
 {
-	// Join the signal handling thread
-	pthread_kill(thread->native_handle(), SIGUSR1);
-	thread->join();
-
-	// Clean up
-	delete thread;
-	thread = nullptr;
+	if(fd >= 0)
+		close(fd);
 }
 
-// This is the thread that waits for a signal and handles it.
-void SignalHandler::Thread()
+// This reads the signals that are waiting and handles them
+void SignalHandler::HandleSignals()
 {
-	sigset_t signal_set;
-	siginfo_t sig;
-
-	while(true)
+	signalfd_siginfo sig;
+	while(read(fd, &sig, sizeof(sig)) == sizeof(sig))
 	{
-		// Wait for a signal and handle it
-		sigfillset(&signal_set);
-		sigwaitinfo(&signal_set, &sig);
-		switch(sig.si_signo)
+		switch(sig.ssi_signo)
 		{
 			// Exit signals from OS
 			case SIGQUIT:
 				std::cout << "Received SIGQUIT signal." << std::endl;
 				exitsignal = true;
-				return;
+				break;
 
 			case SIGINT:
 				// Only accept SIGINT from TTY
-				if(sig.si_pid == 0)
+				if(sig.ssi_pid == 0)
 				{
 					std::cout << "Received SIGINT signal." << std::endl;
 					exitsignal = true;
-					return;
 				}
 				break;
 
 			case SIGTERM:
 				std::cout << "Received SIGTERM signal." << std::endl;
 				exitsignal = true;
-				return;
+				break;
 
+			// Hangup exits, unless it is used to reload
 			case SIGHUP:
 				std::cout << "Received SIGHUP signal." << std::endl;
-				exitsignal = true;
-				return;
+				if(reloadonhangup)
+					reloadsignal = true;
+				else
+					exitsignal = true;
+				break;
 
-			// This is raised by the destructor when this thread should stop
-			case SIGUSR1:
-				return;
+			// Request to show statistics
+			case SIGUSR2:
+				statssignal = true;
+				break;
 
 			// We ignore all other signals
 			default:
@@ -85,4 +88,3 @@ void SignalHandler::Thread()
 		}
 	}
 }
-
@@ -3,16 +3,21 @@
 	This software is released under MIT license.
 */
 #pragma once
-#include <thread>
-#include <atomic>
 
+/*
+	This receives the signals of the process through a signalfd, which becomes readable
+	when a signal is waiting. The owner waits for it (see EventLoop) and calls HandleSignals.
+*/
 class SignalHandler final
 {
 private:
 
 	// Members
-	std::atomic<bool> exitsignal;
-	std::thread* thread;
+	int fd;
+	bool exitsignal;
+	bool statssignal;
+	bool reloadonhangup;
+	bool reloadsignal;
 
 public:
 
@@ -20,9 +25,19 @@ public:
 	SignalHandler();
 	~SignalHandler();
 
-	// This is the thread that waits for a signal and handles it.
-	void Thread();
+	// This reads the signals that are waiting and handles them
+	void HandleSignals();
 
 	// Getters/setters
+	int GetFd() const { return fd; }
 	bool GetExitSignal() const { return exitsignal; }
+
+	// When enabled, SIGHUP requests a reload instead of exiting
+	void SetReloadOnHangup(bool enable) { reloadonhangup = enable; }
+
+	// Returns True once after a reload was requested (SIGHUP)
+	bool TakeReloadSignal() { bool result = reloadsignal; reloadsignal = false; return result; }
+
+	// Returns True once after statistics were requested (SIGUSR2)
+	bool TakeStatsSignal() { bool result = statssignal; statssignal = false; return result; }
 };
@@ -0,0 +1,290 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include <iostream>
+#include <sstream>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "StateServer.h"
+
+// This removes the socket at the specified path. Anything else at the path is left alone,
+// because a mistyped path must not delete a file. Returns False when the path is not a socket.
+static bool RemoveSocket(const std::string& socketpath)
+{
+	struct stat info;
+	if(lstat(socketpath.c_str(), &info) != 0)
+		return true;
+
+	if(!S_ISSOCK(info.st_mode))
+		return false;
+
+	unlink(socketpath.c_str());
+	return true;
+}
+
+// Constructor
+StateServer::StateServer(DeviceTable& devicetable) :
+	devices(devicetable),
+	listenfd(-1),
+	stopfd(-1),
+	thread(nullptr)
+{
+}
+
+// Destructor
+StateServer::~StateServer()
+{
+	Stop();
+}
+
+// This starts listening on the specified socket path.
+// Returns an error message or an empty string on success.
+std::string StateServer::Start(const std::string& socketpath)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(socketpath.size() >= sizeof(address.sun_path))
+		return "Socket path " + socketpath + " is too long.";
+	strncpy(address.sun_path, socketpath.c_str(), sizeof(address.sun_path) - 1);
+
+	// Remove the socket left by a previous run
+	if(!RemoveSocket(socketpath))
+		return "Unable to listen on " + socketpath + ": the file exists and is not a socket.";
+
+	listenfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if(listenfd < 0)
+		return std::string("Unable to create socket: ") + strerror(errno);
+
+	if((bind(listenfd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) || (listen(listenfd, 8) != 0))
+	{
+		std::string error = "Unable to listen on " + socketpath + ": " + strerror(errno);
+		close(listenfd);
+		listenfd = -1;
+		return error;
+	}
+
+	stopfd = eventfd(0, EFD_CLOEXEC);
+	if(stopfd < 0)
+	{
+		std::string error = std::string("Unable to create eventfd: ") + strerror(errno);
+		close(listenfd);
+		listenfd = -1;
+		RemoveSocket(socketpath);
+		return error;
+	}
+
+	path = socketpath;
+	thread = new std::thread(&StateServer::ServerThread, this);
+	return std::string();
+}
+
+// This stops listening and disconnects all clients
+void StateServer::Stop()
+{
+	if(thread != nullptr)
+	{
+		uint64 one = 1;
+		if(write(stopfd, &one, sizeof(one)) != sizeof(one))
+			std::cout << "Error stopping state server: " << strerror(errno) << std::endl;
+		thread->join();
+		delete thread;
+		thread = nullptr;
+	}
+
+	if(listenfd >= 0)
+	{
+		close(listenfd);
+		RemoveSocket(path);
+	}
+	if(stopfd >= 0)
+		close(stopfd);
+	listenfd = -1;
+	stopfd = -1;
+}
+
+// This is the thread which serves the clients
+void StateServer::ServerThread()
+{
+	std::vector<Client> clients;
+	std::vector<pollfd> fds;
+	while(true)
+	{
+		// Wait for the stop signal, a new client or a client which is ready
+		fds.resize(2 + clients.size());
+		fds[0] = pollfd { stopfd, POLLIN, 0 };
+		fds[1] = pollfd { listenfd, static_cast<short>((clients.size() < MAX_CLIENTS) ? POLLIN : 0), 0 };
+		for(std::size_t i = 0; i < clients.size(); i++)
+			fds[2 + i] = pollfd { clients[i].fd, static_cast<short>((clients[i].output.size() > 0) ? POLLOUT : POLLIN), 0 };
+
+		if(poll(fds.data(), fds.size(), -1) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			std::cout << "Error waiting for state server clients: " << strerror(errno) << std::endl;
+			break;
+		}
+
+		if(fds[0].revents != 0)
+			break;
+
+		// Serve the clients. Clients which are gone are removed.
+		std::size_t kept = 0;
+		for(std::size_t i = 0; i < clients.size(); i++)
+		{
+			short events = fds[2 + i].revents;
+			bool alive = true;
+			if((events & POLLOUT) != 0)
+				alive = WriteClient(clients[i]);
+			else if((events & (POLLIN | POLLHUP | POLLERR)) != 0)
+			{
+				// A client may close its side right after its request, so we respond anyway
+				alive = ReadClient(clients[i]);
+				alive = WriteClient(clients[i]) && alive;
+			}
+
+			if(alive)
+			{
+				if(kept != i)
+					clients[kept] = std::move(clients[i]);
+				kept++;
+			}
+			else
+				close(clients[i].fd);
+		}
+		clients.resize(kept);
+
+		// Accept a new client
+		if((fds[1].revents & POLLIN) != 0)
+		{
+			int fd = accept4(listenfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if(fd >= 0)
+				clients.push_back(Client { fd, std::string(), std::string() });
+		}
+	}
+
+	for(Client& client : clients)
+		close(client.fd);
+}
+
+// This reads from a client and handles its requests. Returns False when the client is gone.
+bool StateServer::ReadClient(Client& client)
+{
+	char buffer[1024];
+	ssize_t count = read(client.fd, buffer, sizeof(buffer));
+	if(count <= 0)
+		return (count < 0) && ((errno == EAGAIN) || (errno == EINTR));
+
+	client.input.append(buffer, static_cast<std::size_t>(count));
+	std::size_t eol;
+	while((eol = client.input.find('\n')) != std::string::npos)
+	{
+		std::string request = client.input.substr(0, eol);
+		client.input.erase(0, eol + 1);
+		HandleRequest(request, client.output);
+	}
+
+	// A client which never ends its request is not welcome
+	return client.input.size() <= MAX_REQUEST_LENGTH;
+}
+
+// This writes the response to a client. Returns False when the client is gone.
+bool StateServer::WriteClient(Client& client)
+{
+	if(client.output.size() == 0)
+		return true;
+
+	ssize_t count = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+	if(count < 0)
+		return (errno == EAGAIN) || (errno == EINTR);
+
+	client.output.erase(0, static_cast<std::size_t>(count));
+	return true;
+}
+
+// This handles a request and adds the response to the output
+void StateServer::HandleRequest(const std::string& request, std::string& output)
+{
+	std::istringstream words(request);
+	std::string command;
+	words >> command;
+
+	if(command == "GET")
+	{
+		std::string addressword, unitword;
+		words >> addressword >> unitword;
+
+		// The address is either a decimal number or 26 binary symbols
+		char* end = nullptr;
+		uint address = 0;
+		bool valid = (addressword.size() > 0);
+		if(addressword.size() == 26)
+		{
+			for(char c : addressword)
+			{
+				valid = valid && ((c == '0') || (c == '1'));
+				address = (address << 1) | static_cast<uint>(c == '1');
+			}
+		}
+		else
+		{
+			address = static_cast<uint>(strtoul(addressword.c_str(), &end, 10));
+			valid = valid && (*end == '\0');
+		}
+
+		bool group = (unitword == "group");
+		uint unit = 0;
+		if(!group)
+		{
+			unit = static_cast<uint>(strtoul(unitword.c_str(), &end, 10));
+			valid = valid && (unitword.size() > 0) && (*end == '\0') && (unit < 16);
+		}
+
+		if(!valid)
+		{
+			output += "ERROR Use GET <address> <unit> or GET <address> group\n";
+			return;
+		}
+
+		DeviceTable::Device device;
+		if(devices.Find(address, unit, group, device))
+			FormatDevice(device, output);
+		else
+			output += "UNKNOWN\n";
+	}
+	else if(command == "LIST")
+	{
+		devices.ForEach([&output](const DeviceTable::Device& device) { FormatDevice(device, output); });
+		output += "END\n";
+	}
+	else if(command == "STATS")
+	{
+		output += "devices " + std::to_string(devices.GetCount()) +
+			" updates " + std::to_string(devices.GetUpdateCount()) +
+			" ignored " + std::to_string(devices.GetIgnoredCount()) + "\n";
+	}
+	else if(command.size() > 0)
+	{
+		output += "ERROR Unknown command " + command + "\n";
+	}
+}
+
+// This adds the description of a device to the output
+void StateServer::FormatDevice(const DeviceTable::Device& device, std::string& output)
+{
+	static const char* statenames[] = { "off", "on", "dim" };
+	output += std::to_string(device.address) + " " +
+		(device.group ? std::string("group") : std::to_string(device.unit)) + " " +
+		statenames[static_cast<int>(device.state)] + " " +
+		std::to_string(device.dimlevel) + " " +
+		std::to_string(device.time) + " " +
+		std::to_string(device.hits) + "\n";
+}
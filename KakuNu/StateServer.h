@@ -0,0 +1,77 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include "Tools.h"
+#include "DeviceTable.h"
+
+/*
+	This answers queries about the device table on a local (unix domain) socket.
+	Requests and responses are lines of text:
+
+		GET <address> <unit>	The last state of a unit, or UNKNOWN
+		GET <address> group		The last group command for an address, or UNKNOWN
+		LIST					All devices, followed by END
+		STATS					Number of devices and messages
+
+	The address is a decimal number or 26 binary symbols (as in the codes output by kakunu).
+	A device is described as: <address> <unit or 'group'> <on, off or dim> <dim level> <time> <hits>
+	where time is the wall clock time of the last message, in microseconds since the epoch.
+*/
+class StateServer
+{
+private:
+
+	// Constants
+	const std::size_t MAX_CLIENTS = 16;
+	const std::size_t MAX_REQUEST_LENGTH = 256;
+
+	// A connected client and its unfinished request and response
+	struct Client
+	{
+		int fd;
+		std::string input;
+		std::string output;
+	};
+
+	// The devices we answer about
+	DeviceTable& devices;
+
+	// The socket we listen on and the thread which serves the clients
+	std::string path;
+	int listenfd;
+	int stopfd;
+	std::thread* thread;
+
+	// This is the thread which serves the clients
+	void ServerThread();
+
+	// This reads from a client and handles its requests. Returns False when the client is gone.
+	bool ReadClient(Client& client);
+
+	// This writes the response to a client. Returns False when the client is gone.
+	bool WriteClient(Client& client);
+
+	// This handles a request and adds the response to the output
+	void HandleRequest(const std::string& request, std::string& output);
+
+	// This adds the description of a device to the output
+	static void FormatDevice(const DeviceTable::Device& device, std::string& output);
+
+public:
+
+	// Constructor / destructor
+	StateServer(DeviceTable& devicetable);
+	virtual ~StateServer();
+
+	// This starts listening on the specified socket path.
+	// Returns an error message or an empty string on success.
+	std::string Start(const std::string& socketpath);
+
+	// This stops listening and disconnects all clients
+	void Stop();
+};
@@ -4,6 +4,18 @@
 */
 #pragma once
 
+typedef unsigned short int uint16;
 typedef unsigned int uint;
 typedef signed long long int int64;
 typedef unsigned long long int uint64;
+
+// Pulse durations are stored in microseconds as 16 bit values.
+// Everything of interest fits easily, only the long gap after a message
+// can be longer and is saturated at MAX_PULSE_US.
+const uint16 MAX_PULSE_US = 0xFFFF;
+
+// This converts a duration in microseconds to a pulse duration, saturating at MAX_PULSE_US.
+inline uint16 SaturatePulse(uint64 microseconds)
+{
+	return (microseconds > MAX_PULSE_US) ? MAX_PULSE_US : static_cast<uint16>(microseconds);
+}
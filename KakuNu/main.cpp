@@ -6,6 +6,13 @@
 #include <errno.h>
 #include <string.h>
 #include <functional>
+#include <algorithm>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <limits>
+#include <time.h>
+#include <sys/stat.h>
 #ifdef PIGPIO_IF2
 #include <pigpiod_if2.h>
 #else
@@ -16,6 +23,20 @@
 #include "KakuDecoder.h"
 #include "SignalHandler.h"
 #include "InputHandler.h"
+#include "EventLoop.h"
+#include "SampleReader.h"
+#include "OokReader.h"
+#include "OokWriter.h"
+#include "Replayer.h"
+#include "CaptureReader.h"
+#include "CaptureWriter.h"
+#include "JournalWriter.h"
+#include "DeviceTable.h"
+#include "StateServer.h"
+#include "AddressFilter.h"
+#include "CodeMatcher.h"
+#include "CodeCorrector.h"
+#include "ParameterFile.h"
 
 // ccxopts raises some warnings (and rightfully so) about integer conversion
 // but instead of messing with the source code I chose to silence these warnings.
@@ -28,6 +49,12 @@
 
 using namespace std::placeholders;
 
+// Interval in milliseconds in which the journal writes its last event when the repeats are over
+const uint JOURNAL_FLUSH_MS = 100;
+
+// Interval in milliseconds in which the recorder takes the edges buffered by the receiver
+const uint RECORD_DELIVER_MS = 100;
+
 // This lists the available options on the command line and parses the given options.
 // Using the ParseResult we can easily determine what options were specified.
 cxxopts::ParseResult ParseCommandLineOptions(int& argc, char**& argv)
@@ -39,8 +66,36 @@ cxxopts::ParseResult ParseCommandLineOptions(int& argc, char**& argv)
 		options
 			.add_options()
 			("help", "Shows information about the command line options.")
-			("p", "BCM GPIO pin to listen on", cxxopts::value<int>()->default_value("27"));
+			("p", "BCM GPIO pin to listen on", cxxopts::value<int>()->default_value("27"))
+			("ingest", "How to receive state changes (callback, notify or gpiochip)", cxxopts::value<std::string>()->default_value("callback"))
+			("chip", "GPIO chip device to use with --ingest gpiochip", cxxopts::value<std::string>()->default_value("/dev/gpiochip0"))
+			("queue-size", "Maximum number of messages waiting to be decoded", cxxopts::value<int>()->default_value("64"))
+			("queue-policy", "Message to drop when the queue is full (oldest or newest)", cxxopts::value<std::string>()->default_value("oldest"))
+			("max-edge-rate", "Edges per second above which the channel is considered noise (0 to disable)", cxxopts::value<int>()->default_value("8000"))
+			("min-plausibility", "Percentage of plausible pulses below which the channel is considered noise", cxxopts::value<int>()->default_value("75"))
+			("min-pulse", "Minimum duration of a plausible pulse in microseconds", cxxopts::value<int>()->default_value("100"))
+			("config", "Read receiver and decoder parameters from this file, which is read again on SIGHUP. Each line is a name and a value: start-duration, end-duration, min-message-times, max-edge-rate, min-plausibility, min-pulse, min-short, min-medium, min-long or min-pause", cxxopts::value<std::string>())
+			("glitch", "Ignore pulses shorter than this many microseconds (0 to disable)", cxxopts::value<int>()->default_value("50"))
+			("samples", "Decode a recording of level samples instead of listening", cxxopts::value<std::string>())
+			("sample-format", "Format of the samples (1bit or 8bit)", cxxopts::value<std::string>()->default_value("1bit"))
+			("rate", "Sample rate of the samples in samples per second", cxxopts::value<uint64>()->default_value("1000000"))
+			("threshold", "Minimum value of a high 8 bit sample (0 to 255)", cxxopts::value<int>()->default_value("1"))
+			("import", "Decode a file of rtl_433 OOK pulse data instead of listening", cxxopts::value<std::string>())
+			("export", "Write received messages to a file of rtl_433 OOK pulse data", cxxopts::value<std::string>())
+			("record", "Write all received edges to a capture file (.kcap)", cxxopts::value<std::string>())
+			("journal", "Append decoded messages to an event journal (.kjnl)", cxxopts::value<std::string>())
+			("socket", "Answer queries about the state of devices on this local socket", cxxopts::value<std::string>())
+			("allow", "Only keep the messages of the addresses listed in this file", cxxopts::value<std::string>())
+			("known", "Recognize the self-learning bitcodes listed in this file while they are received, without decoding", cxxopts::value<std::string>())
+			("correct", "Correct the address of messages which differ in at most this many address symbols from a code listed with --known", cxxopts::value<int>()->default_value("0"))
+			("replay", "Decode these recordings or directories of recordings in parallel (.kcap files are captures, .ook files are rtl_433 pulse data, others are samples)", cxxopts::value<std::vector<std::string>>())
+			("from", "Only replay messages from this many seconds into the recordings", cxxopts::value<double>()->default_value("0"))
+			("to", "Only replay messages until this many seconds into the recordings", cxxopts::value<double>())
+			("jobs", "Number of threads to use with --replay (0 for one per core)", cxxopts::value<int>()->default_value("0"));
+		options.parse_positional("replay");
 		options.custom_help("[options...]");
+		options.positional_help("[recordings...]");
+		options.show_positional_help();
 
 		// Parse the arguments with these options
 		cxxopts::ParseResult cmdargs = options.parse(argc, argv);
@@ -68,72 +123,723 @@ void OutputResults(const std::string& str)
 	std::cout << str << std::endl;
 }
 
+// This outputs a decoded message to std out
+void OutputMessage(const KakuMessage& msg)
+{
+	std::cout << msg.ToLabeledString() << std::endl;
+}
+
+// This outputs a decoded message from a recording to std out, with the time in the recording
+void OutputRecordedMessage(const KakuMessage& msg)
+{
+	std::cout << std::fixed << std::setprecision(6) << (static_cast<double>(msg.time) / 1000000.0)
+		<< " " << msg.ToLabeledString() << std::endl;
+}
+
+// This outputs the statistics of the address filter to std out
+void OutputFilterStatistics(const AddressFilter* filter)
+{
+	if(filter != nullptr)
+	{
+		std::cout << "Address filter: " << filter->GetCount() << " addresses, "
+			<< filter->GetAcceptedCount() << " accepted, "
+			<< filter->GetFilteredCount() << " filtered" << std::endl;
+	}
+}
+
+// This outputs the statistics of the code corrector to std out
+void OutputCorrectorStatistics(const CodeCorrector* corrector)
+{
+	if(corrector != nullptr)
+	{
+		std::cout << "Code correction: " << corrector->GetCorrectedCount() << " corrected, "
+			<< corrector->GetAmbiguousCount() << " ambiguous" << std::endl;
+	}
+}
+
+// This outputs statistics to std out
+void OutputStatistics(RFReceiver& receiver, const KakuDecoder& decoder, const AddressFilter* filter, const CodeCorrector* corrector)
+{
+	RFReceiver::Statistics stats = receiver.GetStatistics();
+	std::cout << "Receiver: " << stats.edges << " edges, "
+		<< stats.batches << " batches, "
+		<< stats.glitches << " glitches, "
+		<< stats.huntededges << " skipped while hunting, "
+		<< stats.huntentries << " noise periods, "
+		<< stats.rejectedstarts << " ignored message starts, "
+		<< stats.savedtime << " us saved, "
+		<< stats.matchedcodes << " known codes, "
+		<< stats.mismatchedcodes << " known codes of another length, "
+		<< stats.droppededges << " edges dropped from the recording" << std::endl;
+
+	std::cout << "Decoder queue: " << decoder.GetQueueDepth() << " waiting, "
+		<< decoder.GetKnownCodeDepth() << " known codes waiting, "
+		<< decoder.GetHighWaterMark() << " high water mark, "
+		<< decoder.GetEnqueuedCount() << " enqueued, "
+		<< decoder.GetDroppedCount() << " dropped" << std::endl;
+
+	std::cout << "Decoder latency: " << decoder.GetLatencyCount() << " messages, "
+		<< decoder.GetAverageLatency() << " us average, "
+		<< decoder.GetMaxLatency() << " us max" << std::endl;
+
+	std::cout << "Protocols:";
+	std::vector<DecoderRegistry::Statistics> protocols = decoder.GetProtocolStatistics();
+	for(std::size_t i = 0; i < protocols.size(); i++)
+	{
+		std::cout << ((i > 0) ? ", " : " ") << protocols[i].name << " " << protocols[i].matched
+			<< " matched " << protocols[i].decoded << " decoded";
+	}
+	std::cout << std::endl;
+
+	OutputCorrectorStatistics(corrector);
+	OutputFilterStatistics(filter);
+}
+
+// This sets up the receiver filters with the command line options
+void SetupReceiverFilters(const cxxopts::ParseResult& cmdargs, RFReceiver& receiver)
+{
+	receiver.SetMaxEdgeRate(static_cast<uint>(std::max(cmdargs["max-edge-rate"].as<int>(), 0)));
+	receiver.SetMinPlausibility(static_cast<uint>(std::max(cmdargs["min-plausibility"].as<int>(), 0)));
+	receiver.SetMinPulseDuration(static_cast<uint>(std::max(cmdargs["min-pulse"].as<int>(), 0)));
+	receiver.SetGlitchDuration(static_cast<uint>(std::max(cmdargs["glitch"].as<int>(), 0)));
+}
+
+// This reads the parameter file over the parameters from the command line options and
+// publishes them to the receiver and the decoder, which take them for the next edge or message.
+// Returns an error message or an empty string on success.
+std::string LoadParameters(const std::string& filename, const RFReceiver::Parameters& receiverbase,
+	const DecoderRegistry::Windows& windowsbase, RFReceiver& receiver, KakuDecoder& decoder)
+{
+	ParameterFile file;
+	std::string error = file.Load(filename, receiverbase, windowsbase);
+	if(error.size() > 0)
+		return error;
+
+	receiver.SetParameters(file.GetReceiverParameters());
+	return decoder.SetWindows(file.GetDecoderWindows());
+}
+
+// This sets up a sample reader with the command line options.
+// Returns False when the options are invalid.
+bool SetupSampleReader(const cxxopts::ParseResult& cmdargs, SampleReader& reader)
+{
+	std::string format = cmdargs["sample-format"].as<std::string>();
+	if(format == "8bit")
+		reader.SetFormat(SampleReader::Format::Bytes8Bit);
+	else if(format != "1bit")
+	{
+		std::cout << "Invalid sample format '" << format << "'. Use '1bit' or '8bit'." << std::endl;
+		return false;
+	}
+	reader.SetSampleRate(cmdargs["rate"].as<uint64>());
+
+	int threshold = cmdargs["threshold"].as<int>();
+	if((threshold < 0) || (threshold > 255))
+	{
+		std::cout << "Invalid threshold " << threshold << ". Use a value from 0 to 255." << std::endl;
+		return false;
+	}
+	reader.SetThreshold(static_cast<uint>(threshold));
+	return true;
+}
+
+// This checks if the filename has the specified extension
+bool HasExtension(const std::string& filename, const std::string& extension)
+{
+	return (filename.size() >= extension.size()) &&
+		(filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0);
+}
+
+// This splits a recording in parts that can be decoded in parallel.
+// Captures are split at their blocks, other recordings are a single part.
+std::vector<Replayer::Part> PartitionRecording(const std::string& filename, uint64 begin, uint64 end)
+{
+	const std::size_t BLOCKS_PER_PART = 16;
+	std::vector<Replayer::Part> parts;
+	CaptureReader reader;
+	if(!HasExtension(filename, ".kcap") || (reader.Open(filename).size() > 0) || (reader.GetBlockCount() == 0))
+	{
+		parts.push_back(Replayer::Part { begin, end });
+		return parts;
+	}
+
+	// Find the blocks in the time range with a binary search
+	std::size_t first = reader.FindBlock(begin);
+	std::size_t last = reader.FindBlock((end > 0) ? (end - 1) : 0);
+	for(std::size_t b = first; b <= last; b += BLOCKS_PER_PART)
+	{
+		Replayer::Part part;
+		part.begin = (b == first) ? begin : reader.GetBlockTime(b);
+		part.end = ((b + BLOCKS_PER_PART) <= last) ? reader.GetBlockTime(b + BLOCKS_PER_PART) : end;
+		parts.push_back(part);
+	}
+	return parts;
+}
+
+// This reads (a part of) a recording and gives its edges to the receiver.
+// Files with the .kcap extension are captures, files with the .ook extension are
+// rtl_433 pulse data and other files are level samples.
+std::string ReadRecording(const cxxopts::ParseResult& cmdargs, const std::string& filename, const Replayer::Part& part, RFReceiver& receiver)
+{
+	if(HasExtension(filename, ".kcap"))
+	{
+		CaptureReader reader;
+		std::string error = reader.Open(filename);
+		if(error.size() == 0)
+			reader.ReadRange(part.begin, part.end, receiver);
+		return error;
+	}
+
+	if(HasExtension(filename, ".ook"))
+	{
+		OokReader reader;
+		return reader.ReadFile(filename, receiver);
+	}
+
+	SampleReader reader;
+	SetupSampleReader(cmdargs, reader);
+	return reader.ReadFile(filename, receiver);
+}
+
+// This sets the callback for received messages.
+// Messages are exported (when specified) before they are decoded. When buffered, the messages
+// are only added to the buffer of the writer, and the main loop writes them to the file.
+void SetMessageCallback(RFReceiver& receiver, OokWriter* writer, bool buffered, std::function<void(const std::vector<uint16>&, uint64)> decode)
+{
+	if(writer != nullptr)
+	{
+		receiver.SetMessageCallback([writer, buffered, decode](const std::vector<uint16>& times, uint64 starttime)
+		{
+			if(buffered)
+				writer->AddMessage(times);
+			else
+				writer->WriteMessage(times);
+			decode(times, starttime);
+		});
+	}
+	else
+	{
+		receiver.SetMessageCallback(decode);
+	}
+}
+
+// This sets the callback for decoded messages and recognized known codes. Messages
+// are added to the journal and the device table (when specified) after they are output.
+void SetResultCallback(KakuDecoder& decoder, JournalWriter* journal, DeviceTable* devices, std::function<void(const KakuMessage&)> output)
+{
+	std::function<void(const KakuMessage&)> result = output;
+	if((journal != nullptr) || (devices != nullptr))
+	{
+		result = [journal, devices, output](const KakuMessage& msg)
+		{
+			output(msg);
+			if(journal != nullptr)
+				journal->AddMessage(msg);
+			if(devices != nullptr)
+				devices->AddMessage(msg);
+		};
+	}
+
+	decoder.SetResultCallback(result);
+}
+
+// This returns the difference between the wall clock and the clock that timestamps the messages
+uint64 GetWallClockBase(RFReceiver::Ingestion ingestion)
+{
+	struct timespec realtime;
+	clock_gettime(CLOCK_REALTIME, &realtime);
+	uint64 now = static_cast<uint64>(realtime.tv_sec) * 1000000 + static_cast<uint64>(realtime.tv_nsec) / 1000;
+
+	// The kernel timestamps line events with the monotonic clock
+	if(ingestion == RFReceiver::Ingestion::GpioChip)
+	{
+		struct timespec monotonic;
+		clock_gettime(CLOCK_MONOTONIC, &monotonic);
+		return now - (static_cast<uint64>(monotonic.tv_sec) * 1000000 + static_cast<uint64>(monotonic.tv_nsec) / 1000);
+	}
+
+	return now - microclock.GetTime();
+}
+
+// This returns the wall clock time at which a recording started, which makes the times of its
+// messages wall clock time. The file was last modified when the recording ended, so for samples
+// we subtract their duration. Pulse data does not keep the pauses between its packages, so its
+// duration is unknown and we take the modification time as the start.
+uint64 GetRecordingTimeBase(const std::string& filename, SampleReader* samples)
+{
+	struct stat info;
+	if(stat(filename.c_str(), &info) != 0)
+		return 0;
+
+	uint64 modified = static_cast<uint64>(info.st_mtim.tv_sec) * 1000000 + static_cast<uint64>(info.st_mtim.tv_nsec) / 1000;
+	if((samples == nullptr) || (samples->GetSampleRate() == 0))
+		return modified;
+
+	uint64 count = static_cast<uint64>(info.st_size);
+	if(samples->GetFormat() == SampleReader::Format::Packed1Bit)
+		count *= 8;
+	uint64 duration = count * 1000000 / samples->GetSampleRate();
+	return modified - std::min(duration, modified);
+}
+
+// This sets the time base of the journal (when specified) for a recording. The journal must stay
+// in order of time, so a recording can't be journaled before the newest event in it.
+// Returns False when the recording is older.
+bool SetJournalTimeBase(JournalWriter* journal, uint64 timebase)
+{
+	if(journal == nullptr)
+		return true;
+
+	if(timebase < journal->GetLastTime())
+	{
+		std::cout << "The recording is older than the newest event in the journal. Use a new journal for older recordings." << std::endl;
+		return false;
+	}
+
+	journal->SetTimeBase(timebase);
+	return true;
+}
+
+// This outputs the number of messages which were too old for the journal to std out
+void OutputJournalStatistics(JournalWriter* journal)
+{
+	if((journal != nullptr) && (journal->GetRejectedCount() > 0))
+		std::cout << "Journal: " << journal->GetRejectedCount() << " messages not written, because they were older than the newest event" << std::endl;
+}
+
+// This decodes a recording of level samples or rtl_433 pulse data
+int DecodeRecording(const cxxopts::ParseResult& cmdargs, RFReceiver& receiver, KakuDecoder& decoder, OokWriter* writer, JournalWriter* journal, const AddressFilter* filter, const CodeMatcher* matcher, const CodeCorrector* corrector)
+{
+	// Messages are decoded right away, so that none are dropped from the queue
+	SetResultCallback(decoder, journal, nullptr, std::bind(&OutputRecordedMessage, _1));
+	decoder.SetErrorCallback(std::bind(&OutputResults, _1));
+	if(matcher != nullptr)
+		receiver.SetCodeMatcher(matcher, std::bind(&KakuDecoder::AddKnownCodeNow, &decoder, _1));
+	SetMessageCallback(receiver, writer, false, std::bind(&KakuDecoder::DecodeMessageNow, &decoder, _1, _2));
+	receiver.StartOffline();
+
+	// The journal gets the messages at the time they were recorded
+	std::string error;
+	if(cmdargs.count("import"))
+	{
+		std::string filename = cmdargs["import"].as<std::string>();
+		if(!SetJournalTimeBase(journal, GetRecordingTimeBase(filename, nullptr)))
+			return 1;
+		OokReader reader;
+		error = reader.ReadFile(filename, receiver);
+	}
+	else
+	{
+		SampleReader reader;
+		if(!SetupSampleReader(cmdargs, reader))
+			return 1;
+		std::string filename = cmdargs["samples"].as<std::string>();
+		if(!SetJournalTimeBase(journal, GetRecordingTimeBase(filename, &reader)))
+			return 1;
+		error = reader.ReadFile(filename, receiver);
+	}
+
+	if(error.size() > 0)
+	{
+		std::cout << error << std::endl;
+		return 1;
+	}
+
+	OutputStatistics(receiver, decoder, filter, corrector);
+	OutputJournalStatistics(journal);
+	return 0;
+}
+
+// This decodes many recordings in parallel and outputs the results in order of time
+int ReplayRecordings(const cxxopts::ParseResult& cmdargs, AddressFilter* filter, const CodeMatcher* matcher, CodeCorrector* corrector)
+{
+	// Check the sample options once, before the workers use them
+	SampleReader samplereader;
+	if(!SetupSampleReader(cmdargs, samplereader))
+		return 1;
+
+	Replayer replayer;
+	for(const std::string& path : cmdargs["replay"].as<std::vector<std::string>>())
+	{
+		std::string error = replayer.AddPath(path);
+		if(error.size() > 0)
+		{
+			std::cout << error << std::endl;
+			return 1;
+		}
+	}
+
+	int jobs = cmdargs["jobs"].as<int>();
+	std::size_t numworkers = (jobs > 0) ? static_cast<std::size_t>(jobs) : std::thread::hardware_concurrency();
+	replayer.SetReceiverSetup(std::bind(&SetupReceiverFilters, std::cref(cmdargs), _1));
+	replayer.SetAddressFilter(filter);
+	replayer.SetCodeMatcher(matcher);
+	replayer.SetCodeCorrector(corrector);
+	replayer.SetPartitioner(std::bind(&PartitionRecording, _1, _2, _3));
+	replayer.SetFileReader(std::bind(&ReadRecording, std::cref(cmdargs), _1, _2, _3));
+
+	// The time range to replay
+	uint64 begin = static_cast<uint64>(std::max(cmdargs["from"].as<double>(), 0.0) * 1000000.0);
+	uint64 end = std::numeric_limits<uint64>::max();
+	if(cmdargs.count("to"))
+		end = static_cast<uint64>(std::max(cmdargs["to"].as<double>(), 0.0) * 1000000.0);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	replayer.Run(numworkers, begin, end);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Output the messages of all files
+	const std::vector<Replayer::FileReport>& reports = replayer.GetReports();
+	for(const Replayer::Result& r : replayer.GetResults())
+	{
+		std::cout << std::fixed << std::setprecision(6) << (static_cast<double>(r.message.time) / 1000000.0)
+			<< " " << reports[r.file].filename << " " << r.message.ToLabeledString() << std::endl;
+	}
+
+	// Output the summary
+	uint64 totalbytes = 0;
+	uint64 totalmessages = 0;
+	int result = 0;
+	for(const Replayer::FileReport& report : reports)
+	{
+		std::cout << report.filename << ": ";
+		if(report.error.size() > 0)
+		{
+			std::cout << report.error << std::endl;
+			result = 1;
+			continue;
+		}
+
+		double rate = (report.seconds > 0.0) ? (static_cast<double>(report.bytes) / report.seconds / 1000000.0) : 0.0;
+		std::cout << report.messages << " messages, " << report.errors << " errors, "
+			<< report.bytes << " bytes in " << std::setprecision(3) << report.seconds << " s ("
+			<< std::setprecision(1) << rate << " MB/s)" << std::endl;
+		totalbytes += report.bytes;
+		totalmessages += report.messages;
+	}
+
+	double rate = (seconds > 0.0) ? (static_cast<double>(totalbytes) / seconds / 1000000.0) : 0.0;
+	std::cout << "Replayed " << replayer.GetFileCount() << " files in " << replayer.GetTaskCount() << " parts with "
+		<< std::min(numworkers, replayer.GetTaskCount()) << " threads: " << totalmessages << " messages, " << totalbytes << " bytes in " << std::setprecision(3) << seconds
+		<< " s (" << std::setprecision(1) << rate << " MB/s)" << std::endl;
+	OutputCorrectorStatistics(corrector);
+	OutputFilterStatistics(filter);
+	return result;
+}
+
 // Main program entry
 int main(int argc, char* argv[])
 {
+	// Set up the signal handler
+	// This MUST be done before ANY threads are created, because it sets some
+	// settings on the main thread that must apply (inherit) for all other threads!
+	SignalHandler sighandler;
+
+	// The decoder has no thread of its own. The results are handled by the
+	// event loop below, or messages are decoded right away from recordings.
 	RFReceiver receiver;
-	KakuDecoder decoder;
+	KakuDecoder decoder(false);
 	int pi = 0;
 
 	// Parse command line options
 	char** nargv = argv;
 	cxxopts::ParseResult cmdargs = ParseCommandLineOptions(argc, nargv);
 
-	// Set up the signal handler
-	// This MUST be done before ANY threads are created, because it sets some
-	// settings on the main thread that must apply (inherit) for all other threads!
-	SignalHandler sighandler;
+	// Setup the decoder queue
+	int queuesize = cmdargs["queue-size"].as<int>();
+	decoder.SetQueueCapacity((queuesize > 0) ? static_cast<std::size_t>(queuesize) : 1);
+	std::string queuepolicy = cmdargs["queue-policy"].as<std::string>();
+	if(queuepolicy == "newest")
+		decoder.SetQueuePolicy(KakuDecoder::QueuePolicy::DropNewest);
+	else if(queuepolicy == "oldest")
+		decoder.SetQueuePolicy(KakuDecoder::QueuePolicy::DropOldest);
+	else
+	{
+		std::cout << "Invalid queue policy '" << queuepolicy << "'. Use 'oldest' or 'newest'." << std::endl;
+		return 1;
+	}
 
-	// Set up the input handler
-	InputHandler inputhandler(true);
+	// Setup the receiver ingestion
+	std::string ingest = cmdargs["ingest"].as<std::string>();
+	if(ingest == "notify")
+		receiver.SetIngestion(RFReceiver::Ingestion::Notify);
+	else if(ingest == "gpiochip")
+		receiver.SetIngestion(RFReceiver::Ingestion::GpioChip);
+	else if(ingest != "callback")
+	{
+		std::cout << "Invalid ingestion '" << ingest << "'. Use 'callback', 'notify' or 'gpiochip'." << std::endl;
+		return 1;
+	}
+	receiver.SetGpioChip(cmdargs["chip"].as<std::string>());
+
+	// Setup the receiver filters
+	SetupReceiverFilters(cmdargs, receiver);
+	receiver.SetMinMessageTimes(decoder.GetMinMessageTimes());
+
+	// Read the parameter file over the command line options. On SIGHUP we read it again,
+	// so parameters which are removed from the file return to their values from here.
+	RFReceiver::Parameters receiverbase = receiver.GetParameters();
+	DecoderRegistry::Windows windowsbase = decoder.GetWindows();
+	std::string parameterfile;
+	if(cmdargs.count("config"))
+	{
+		parameterfile = cmdargs["config"].as<std::string>();
+		std::string error = LoadParameters(parameterfile, receiverbase, windowsbase, receiver, decoder);
+		if(error.size() > 0)
+		{
+			std::cout << error << std::endl;
+			return 1;
+		}
+		sighandler.SetReloadOnHangup(true);
+	}
+
+	// Setup the filter for the addresses we want
+	AddressFilter addressfilter;
+	AddressFilter* filter = nullptr;
+	if(cmdargs.count("allow"))
+	{
+		std::string error = addressfilter.Load(cmdargs["allow"].as<std::string>());
+		if(error.size() > 0)
+		{
+			std::cout << error << std::endl;
+			return 1;
+		}
+		filter = &addressfilter;
+		decoder.SetAddressFilter(filter);
+	}
+
+	// Setup the codes to recognize while receiving
+	CodeMatcher codematcher;
+	CodeMatcher* matcher = nullptr;
+	if(cmdargs.count("known"))
+	{
+		std::string error = codematcher.Load(cmdargs["known"].as<std::string>());
+		if(error.size() > 0)
+		{
+			std::cout << error << std::endl;
+			return 1;
+		}
+		matcher = &codematcher;
+	}
+
+	// Setup the correction of messages near a known code
+	CodeCorrector codecorrector;
+	CodeCorrector* corrector = nullptr;
+	int correct = cmdargs["correct"].as<int>();
+	if(correct > 0)
+	{
+		if(matcher == nullptr)
+		{
+			std::cout << "Use --known to list the codes to correct to." << std::endl;
+			return 1;
+		}
+		codecorrector.SetCodes(codematcher.GetCodes());
+		codecorrector.SetMaxDistance(static_cast<uint>(correct));
+		corrector = &codecorrector;
+		decoder.SetCodeCorrector(corrector);
+	}
+
+	// Replaying recordings uses a receiver and decoder for each thread.
+	// Their results are only ordered by the time into each recording, so they can't be journaled.
+	if(cmdargs.count("replay"))
+	{
+		if(cmdargs.count("journal"))
+		{
+			std::cout << "The journal can not be written while replaying. Use --samples or --import to journal a recording." << std::endl;
+			return 1;
+		}
+		return ReplayRecordings(cmdargs, filter, matcher, corrector);
+	}
 
-	#ifdef PIGPIO_IF2
-		// Setup for use with pigpio_if2 (which locally connects to pigpiod)
-		// We use this for most of the debugging, because Visual Studio doesn't
-		// allow me to start the process with sudo (yet).
-		pi = pigpio_start(nullptr, nullptr);
-		if(pi < 0)
+	// Setup the export of received messages
+	OokWriter exportwriter;
+	OokWriter* writer = nullptr;
+	if(cmdargs.count("export"))
+	{
+		std::string error = exportwriter.Open(cmdargs["export"].as<std::string>());
+		if(error.size() > 0)
+		{
+			std::cout << error << std::endl;
+			return 1;
+		}
+		writer = &exportwriter;
+	}
+
+	// Setup the recording of received edges
+	CaptureWriter recorder;
+	if(cmdargs.count("record"))
+	{
+		std::string error = recorder.Open(cmdargs["record"].as<std::string>());
+		if(error.size() > 0)
 		{
-			std::cout << "Error setting up pigpio_if2: " << strerror(errno) << std::endl;
-			std::cout << "Try 'sudo pigpiod' to start the pigpio daemon." << std::endl;
+			std::cout << error << std::endl;
 			return 1;
 		}
-	#else
-		// Setup for direct use of pigpio (requires sudo)
-		if(gpioInitialise() == PI_INIT_FAILED)
+		receiver.SetEdgeCallback(std::bind(&CaptureWriter::AddEdge, &recorder, _1));
+	}
+
+	// Setup the journal of decoded messages
+	JournalWriter journalwriter;
+	JournalWriter* journal = nullptr;
+	if(cmdargs.count("journal"))
+	{
+		std::string error = journalwriter.Open(cmdargs["journal"].as<std::string>());
+		if(error.size() > 0)
+		{
+			std::cout << error << std::endl;
+			return 1;
+		}
+		journalwriter.SetPin(static_cast<uint>(cmdargs["p"].as<int>()));
+		journal = &journalwriter;
+	}
+
+	// Setup the device table and the server which answers queries about it
+	DeviceTable devicetable;
+	DeviceTable* devices = nullptr;
+	StateServer stateserver(devicetable);
+	if(cmdargs.count("socket"))
+	{
+		std::string error = stateserver.Start(cmdargs["socket"].as<std::string>());
+		if(error.size() > 0)
 		{
-			std::cout << "Error setting up pigpio: " << strerror(errno) << std::endl;
+			std::cout << error << std::endl;
 			return 1;
 		}
-	#endif
-	
-	// Start the clock
-	microclock.Start(pi);
+		devices = &devicetable;
+	}
+
+	// Decoding a recording does not need any hardware
+	if(cmdargs.count("samples") || cmdargs.count("import"))
+		return DecodeRecording(cmdargs, receiver, decoder, writer, journal, filter, matcher, corrector);
+
+	// The GPIO chip does not need pigpio at all
+	bool usepigpio = (receiver.GetIngestion() != RFReceiver::Ingestion::GpioChip);
+
+	if(usepigpio)
+	{
+		#ifdef PIGPIO_IF2
+			// Setup for use with pigpio_if2 (which locally connects to pigpiod)
+			// We use this for most of the debugging, because Visual Studio doesn't
+			// allow me to start the process with sudo (yet).
+			pi = pigpio_start(nullptr, nullptr);
+			if(pi < 0)
+			{
+				std::cout << "Error setting up pigpio_if2: " << strerror(errno) << std::endl;
+				std::cout << "Try 'sudo pigpiod' to start the pigpio daemon." << std::endl;
+				return 1;
+			}
+		#else
+			// Setup for direct use of pigpio (requires sudo)
+			if(gpioInitialise() == PI_INIT_FAILED)
+			{
+				std::cout << "Error setting up pigpio: " << strerror(errno) << std::endl;
+				return 1;
+			}
+		#endif
+
+		// Start the clock
+		microclock.Start(pi);
+	}
 
 	// Setup decoder
-	decoder.SetResultCallback(std::bind(&OutputResults, _1));
+	uint64 wallclockbase = GetWallClockBase(receiver.GetIngestion());
+	journalwriter.SetTimeBase(wallclockbase);
+	devicetable.SetTimeBase(wallclockbase);
+	SetResultCallback(decoder, journal, devices, std::bind(&OutputMessage, _1));
 	decoder.SetErrorCallback(std::bind(&OutputResults, _1));
 
+	// Known codes are recognized on the receiver thread and handled like decoded messages
+	if(matcher != nullptr)
+		receiver.SetCodeMatcher(matcher, std::bind(&KakuDecoder::AddKnownCode, &decoder, _1));
+
 	// Start the RF receiver
 	int pin = cmdargs["p"].as<int>();
 	std::cout << "Listening on pin " << pin << ". Press ENTER to exit." << std::endl;
-	receiver.SetMessageCallback(std::bind(&KakuDecoder::DecodeMessage, &decoder, _1, _2));
+	SetMessageCallback(receiver, writer, true, std::bind(&KakuDecoder::DecodeMessage, &decoder, _1, _2));
 	receiver.Start(pi, pin);
 
-	// Sleep this thread until exit request is signalled
-	while(!sighandler.GetExitSignal() && !inputhandler.GetExitSignal())
+	// Handle signals, input, decoded messages and the journal on this thread until exit is requested
+	InputHandler inputhandler(true);
+	EventLoop eventloop;
+	std::string error = eventloop.Add(sighandler.GetFd(), [&]()
+	{
+		sighandler.HandleSignals();
+		if(sighandler.GetExitSignal())
+			eventloop.Stop();
+
+		// Show statistics when requested with SIGUSR2
+		if(sighandler.TakeStatsSignal())
+			OutputStatistics(receiver, decoder, filter, corrector);
+
+		// Read the parameter file again when requested with SIGHUP.
+		// Edges are handled meanwhile and take the new parameters as soon as they are published.
+		// When the file can't be read, we keep receiving with the parameters we have.
+		if(sighandler.TakeReloadSignal())
+		{
+			std::string reloaderror = LoadParameters(parameterfile, receiverbase, windowsbase, receiver, decoder);
+			if(reloaderror.size() > 0)
+				std::cout << reloaderror << " The parameters are not changed." << std::endl;
+			else
+				std::cout << "Parameters read from " << parameterfile << "." << std::endl;
+		}
+	});
+	if(error.size() == 0)
+		error = eventloop.Add(decoder.GetWakeupFd(), std::bind(&KakuDecoder::ProcessPending, &decoder));
+	if(error.size() == 0)
+	{
+		// Write the last event to the journal when its repeats are over
+		if(journal != nullptr)
+			error = eventloop.AddTimer(JOURNAL_FLUSH_MS, std::bind(&JournalWriter::FlushIdle, journal));
+	}
+	if((error.size() == 0) && (writer != nullptr))
+	{
+		// Write the messages buffered for the export
+		error = eventloop.Add(writer->GetFd(), std::bind(&OokWriter::WriteBuffered, writer));
+	}
+	if((error.size() == 0) && cmdargs.count("record"))
+	{
+		// Write the edges buffered by the receiver when many are waiting and periodically
+		error = eventloop.Add(receiver.GetEdgeFd(), std::bind(&RFReceiver::DeliverEdges, &receiver));
+		if(error.size() == 0)
+			error = eventloop.AddTimer(RECORD_DELIVER_MS, std::bind(&RFReceiver::DeliverEdges, &receiver));
+	}
+	if(error.size() == 0)
 	{
-		// Sleep for 100ms
-		time_sleep(0.1);
+		// Input can not be waited for when it is a file (such as /dev/null for a service),
+		// then there is no ENTER to wait for and the error is ignored.
+		eventloop.Add(inputhandler.GetFd(), [&]()
+		{
+			inputhandler.HandleInput();
+			if(inputhandler.GetExitSignal())
+				eventloop.Stop();
+			else if(inputhandler.GetEndOfInput())
+				eventloop.Remove(inputhandler.GetFd());
+		});
+
+		eventloop.Run();
+	}
+	else
+	{
+		std::cout << error << std::endl;
 	}
 
 	// Clean up
 	receiver.Stop();
-	#ifdef PIGPIO_IF2
-		pigpio_stop(pi);
-	#else
-		gpioTerminate();
-	#endif
+	recorder.Close();
+	exportwriter.Close();
+	if(exportwriter.GetDroppedCount() > 0)
+		std::cout << exportwriter.GetDroppedCount() << " messages were not exported, because the buffer was full." << std::endl;
+	journalwriter.Close();
+	OutputJournalStatistics(journal);
+	stateserver.Stop();
+	if(usepigpio)
+	{
+		#ifdef PIGPIO_IF2
+			pigpio_stop(pi);
+		#else
+			gpioTerminate();
+		#endif
+	}
 	std::cout << "Bye!" << std::endl;
 	return 0;
 }
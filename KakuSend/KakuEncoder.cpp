@@ -2,7 +2,6 @@
 	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
 	This software is released under MIT license.
 */
-#include <assert.h>
 #include "KakuEncoder.h"
 
 // Constructor
@@ -61,72 +60,75 @@ KakuEncoder::~KakuEncoder()
 				  3 bit = subbits 1 1
 */
 
-// Encodes bits to pulse durations
-std::string KakuEncoder::Encode(std::string bits, std::vector<uint>& timesout)
+// Returns the error message for a result, or an empty string on success
+const char* KakuEncoder::GetResultMessage(Result result)
 {
-	timesout.clear();
-
-	// Every 'bit' in the code should be either 0, 1, 2 or 3.
-	// Convert them to integers for easier parsing.
-	std::vector<int> bitcodes;
-	for(const char& c : bits)
+	switch(result)
 	{
-		int i = static_cast<int>(c);
+		case Result::Success:
+			return "";
 
-		// Validate each bit code
-		if((i < 48) || (i > 51))
+		case Result::InvalidBits:
 			return "Unable to encode bitcode. Invalid bits.";
 
-		bitcodes.push_back(i - 48);
-	}
+		case Result::InvalidAddress:
+			return "Unable to encode message. Invalid address.";
 
-	// Add start pulses
-	timesout.push_back(SHORT_US);
-	timesout.push_back(EXTRALONG_US);
+		case Result::InvalidUnit:
+			return "Unable to encode message. Invalid unit.";
 
-	// Make pulses for the bit codes
-	for(int b : bitcodes)
-	{
-		switch(b)
-		{
-			case 0:
-				timesout.push_back(SHORT_US);
-				timesout.push_back(SHORT_US);
-				timesout.push_back(SHORT_US);
-				timesout.push_back(LONG_US);
-				break;
-
-			case 1:
-				timesout.push_back(SHORT_US);
-				timesout.push_back(LONG_US);
-				timesout.push_back(SHORT_US);
-				timesout.push_back(SHORT_US);
-				break;
-
-			case 2:
-				timesout.push_back(SHORT_US);
-				timesout.push_back(SHORT_US);
-				timesout.push_back(SHORT_US);
-				timesout.push_back(SHORT_US);
-				break;
-
-			case 3:
-				timesout.push_back(SHORT_US);
-				timesout.push_back(LONG_US);
-				timesout.push_back(SHORT_US);
-				timesout.push_back(LONG_US);
-				break;
-
-			default:
-				assert(false);
-		}
+		case Result::InvalidDimLevel:
+			return "Unable to encode message. Invalid dim level.";
+
+		case Result::BufferTooSmall:
+			return "Unable to encode message. The buffer is too small.";
+
+		default:
+			return "Unable to encode message.";
 	}
+}
 
-	// Add end pulses
-	timesout.push_back(SHORT_US);
-	timesout.push_back(MEGALONG_US);
+// Encodes the fields of a self-learning message to pulse durations in the buffer
+KakuEncoder::Result KakuEncoder::Encode(const KakuFields& fields, uint16* timesout, uint capacity, uint& count)
+{
+	count = 0;
+
+	// Validate the fields, because these would not fit in their symbols
+	if((fields.address == 0) || (fields.address >= (1U << KakuMessage::ADDRESS_BITS)))
+		return Result::InvalidAddress;
+	if(fields.unit > 15)
+		return Result::InvalidUnit;
+	if(fields.dimlevel > 15)
+		return Result::InvalidDimLevel;
+
+	KakuMessage msg;
+	msg.SetFields(fields);
+	if(capacity < GetMessageTimes(msg.length))
+		return Result::BufferTooSmall;
+
+	AddStart(timesout, count);
+	for(uint i = 0; i < msg.length; i++)
+		AddSymbol(msg.GetSymbol(i), timesout, count);
+	AddEnd(timesout, count);
+	return Result::Success;
+}
 
-	// Done
-	return std::string();
+// Encodes bits to pulse durations
+std::string KakuEncoder::Encode(const std::string& bits, std::vector<uint16>& timesout)
+{
+	timesout.resize(GetMessageTimes(static_cast<uint>(bits.size())));
+	uint count = 0;
+	Result result = Encode(bits.c_str(), static_cast<uint>(bits.size()), timesout.data(), static_cast<uint>(timesout.size()), count);
+	timesout.resize(count);
+	return GetResultMessage(result);
 }
 
+// Encodes the fields of a self-learning message to pulse durations
+std::string KakuEncoder::Encode(const KakuFields& fields, std::vector<uint16>& timesout)
+{
+	timesout.resize(GetMessageTimes(KakuMessage::DIM_FIELDS_SYMBOLS));
+	uint count = 0;
+	Result result = Encode(fields, timesout.data(), static_cast<uint>(timesout.size()), count);
+	timesout.resize(count);
+	return GetResultMessage(result);
+}
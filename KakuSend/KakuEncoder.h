@@ -5,24 +5,136 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <array>
 #include "../KakuNu/Tools.h"
+#include "../KakuNu/KakuMessage.h"
+#include "../KakuNu/ProtocolSpec.h"
 
 class KakuEncoder
 {
 private:
 
-	// Constants
-	const uint SHORT_US = 250;
-	const uint LONG_US = SHORT_US * 5;
-	const uint EXTRALONG_US = SHORT_US * 10;
-	const uint MEGALONG_US = SHORT_US * 40;
+	// Timings
+	static constexpr uint16 SHORT_US = SelfLearningSpec::SHORT.nominal;
+	static constexpr uint16 START_US = SelfLearningSpec::START_LOW.nominal;
+	static constexpr uint16 STOP_US = SelfLearningSpec::STOP_LOW.nominal;
+
+	// This table gives the pulses of every symbol. A subbit is a short high
+	// and a low of which the duration depends on the subbit.
+	typedef std::array<std::array<uint16, 4>, 4> PulseTable;
+	static constexpr PulseTable PULSE_TABLE = []()
+	{
+		PulseTable table = { };
+		for(uint s = 0; s < 4; s++)
+		{
+			for(uint b = 0; b < 2; b++)
+			{
+				uint subbit = (SelfLearningSpec::SYMBOL_SUBBITS[s] >> b) & 1;
+				table[s][b * 2] = SHORT_US;
+				table[s][b * 2 + 1] = static_cast<uint16>(SelfLearningSpec::SUBBIT_LOW[subbit].nominal);
+			}
+		}
+		return table;
+	}();
+
+	// Adds the start pulses to the buffer
+	static constexpr void AddStart(uint16* timesout, uint& count)
+	{
+		timesout[count++] = SHORT_US;
+		timesout[count++] = START_US;
+	}
+
+	// Adds the pulses of a symbol to the buffer
+	static constexpr void AddSymbol(uint symbol, uint16* timesout, uint& count)
+	{
+		for(uint16 t : PULSE_TABLE[symbol])
+			timesout[count++] = t;
+	}
+
+	// Adds the end pulses to the buffer
+	static constexpr void AddEnd(uint16* timesout, uint& count)
+	{
+		timesout[count++] = SHORT_US;
+		timesout[count++] = STOP_US;
+	}
 
 public:
 
+	// Result of encoding into a buffer
+	enum class Result : int
+	{
+		Success = 0,
+		InvalidBits = 1,
+		InvalidAddress = 2,
+		InvalidUnit = 3,
+		InvalidDimLevel = 4,
+		BufferTooSmall = 5
+	};
+
+	// Number of timings of the longest message. A buffer of this size fits any message.
+	static constexpr uint MAX_TIMES = KakuMessage::MAX_SYMBOLS * 4 + 4;
+
+	// Timings of a message in a buffer with a fixed capacity
+	template<uint CAPACITY>
+	struct Pulses
+	{
+		uint16 times[CAPACITY] = { };
+		uint count = 0;
+	};
+
+	// Returns the number of timings of a message with the specified number of symbols
+	static constexpr uint GetMessageTimes(uint symbols) { return symbols * 4 + 4; }
+
+	// Returns the error message for a result, or an empty string on success
+	static const char* GetResultMessage(Result result);
+
+	// Encodes bits (the characters 0, 1, 2 or 3) to pulse durations in the buffer.
+	// The buffer must have room for GetMessageTimes(length) timings.
+	// This does not allocate and can be used in constant expressions.
+	static constexpr Result Encode(const char* bits, uint length, uint16* timesout, uint capacity, uint& count)
+	{
+		count = 0;
+		if(capacity < GetMessageTimes(length))
+			return Result::BufferTooSmall;
+
+		// Validate all bits before writing anything
+		for(uint i = 0; i < length; i++)
+		{
+			if((bits[i] < '0') || (bits[i] > '3'))
+				return Result::InvalidBits;
+		}
+
+		AddStart(timesout, count);
+		for(uint i = 0; i < length; i++)
+			AddSymbol(static_cast<uint>(bits[i] - '0'), timesout, count);
+		AddEnd(timesout, count);
+		return Result::Success;
+	}
+
+	// Encodes the fields of a self-learning message to pulse durations in the buffer.
+	// The buffer must have room for GetMessageTimes(KakuMessage::DIM_FIELDS_SYMBOLS) timings.
+	// This does not allocate.
+	static Result Encode(const KakuFields& fields, uint16* timesout, uint capacity, uint& count);
+
+	// Encodes a known bitcode at compile time, for example:
+	// constexpr auto pulses = KakuEncoder::EncodeCode("0101...");
+	// The count of the pulses is 0 when the bitcode is invalid.
+	template<uint LENGTH>
+	static constexpr Pulses<(LENGTH - 1) * 4 + 4> EncodeCode(const char (&bits)[LENGTH])
+	{
+		Pulses<(LENGTH - 1) * 4 + 4> pulses;
+		if(Encode(bits, LENGTH - 1, pulses.times, (LENGTH - 1) * 4 + 4, pulses.count) != Result::Success)
+			pulses.count = 0;
+		return pulses;
+	}
+
 	// Constructor / destructor
 	KakuEncoder();
 	virtual ~KakuEncoder();
 
 	// Encodes bits to pulse durations
-	std::string Encode(std::string bits, std::vector<uint>& timesout);
+	std::string Encode(const std::string& bits, std::vector<uint16>& timesout);
+
+	// Encodes the fields of a self-learning message to pulse durations
+	std::string Encode(const KakuFields& fields, std::vector<uint16>& timesout);
 };
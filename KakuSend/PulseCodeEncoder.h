@@ -0,0 +1,63 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <vector>
+#include <array>
+#include "../KakuNu/Tools.h"
+#include "../KakuNu/ProtocolSpec.h"
+
+/*
+	This encodes symbols of a protocol as described by Spec (see TriStateSpec and EV1527Spec).
+	See PulseCodeDecoder for a description of these protocols.
+*/
+template<class Spec>
+class PulseCodeEncoder
+{
+private:
+
+	// Timings
+	static constexpr uint16 SHORT_US = Spec::UNIT_US * Spec::SHORT_UNITS;
+	static constexpr uint16 LONG_US = Spec::UNIT_US * Spec::LONG_UNITS;
+	static constexpr uint16 SYNC_US = Spec::UNIT_US * Spec::SYNC_UNITS;
+
+	// This table gives the pulses of every symbol. A 0 bit is a short high and a long low,
+	// a 1 bit is a long high and a short low.
+	static constexpr uint SYMBOL_TIMES = Spec::BITS_PER_SYMBOL * 2;
+	typedef std::array<std::array<uint16, SYMBOL_TIMES>, Spec::NUM_SYMBOL_VALUES> PulseTable;
+	static constexpr PulseTable MakePulseTable()
+	{
+		PulseTable table = { };
+		for(uint s = 0; s < Spec::NUM_SYMBOL_VALUES; s++)
+		{
+			for(uint b = 0; b < Spec::BITS_PER_SYMBOL; b++)
+			{
+				bool bit = ((Spec::SYMBOL_BITS[s] >> b) & 1) != 0;
+				table[s][b * 2] = bit ? LONG_US : SHORT_US;
+				table[s][b * 2 + 1] = bit ? SHORT_US : LONG_US;
+			}
+		}
+		return table;
+	}
+	static constexpr PulseTable PULSE_TABLE = MakePulseTable();
+
+public:
+
+	// Number of symbols of a message
+	static constexpr uint SYMBOLS = Spec::SYMBOLS;
+
+	// Encodes the symbols of a message to pulse durations.
+	// The symbols must be below Spec::NUM_SYMBOL_VALUES and there must be SYMBOLS of them.
+	static void Encode(const std::vector<uint>& symbols, std::vector<uint16>& timesout)
+	{
+		timesout.clear();
+		timesout.reserve(Spec::SYMBOLS * SYMBOL_TIMES + 2);
+		for(uint s : symbols)
+			timesout.insert(timesout.end(), PULSE_TABLE[s].begin(), PULSE_TABLE[s].end());
+
+		// Add sync pulses
+		timesout.push_back(SHORT_US);
+		timesout.push_back(SYNC_US);
+	}
+};
@@ -25,7 +25,13 @@ RFTransmitter::~RFTransmitter()
 }
 
 // This transmits the specified pulses
-void RFTransmitter::Send(int pidevice, int pin, const std::vector<uint>& times, int repeat)
+void RFTransmitter::Send(int pidevice, int pin, const std::vector<uint16>& times, int repeat)
+{
+	Send(pidevice, pin, times.data(), static_cast<uint>(times.size()), repeat);
+}
+
+// This transmits the specified pulses from a buffer
+void RFTransmitter::Send(int pidevice, int pin, const uint16* times, uint count, int repeat)
 {
 	this->pi = pidevice;
 	this->pin = pin;
@@ -45,7 +51,7 @@ void RFTransmitter::Send(int pidevice, int pin, const std::vector<uint>& times,
 
 	for(int r = 0; r < repeat; r++)
 	{
-		for(size_t i = 0; i < (times.size() - 1); i += 2)
+		for(uint i = 0; (i + 1) < count; i += 2)
 		{
 			// Send a pulse with high time and the with low time
 			SetPinLevel(1);
@@ -32,6 +32,7 @@ public:
 	virtual ~RFTransmitter();
 
 	// This transmits the specified pulses
-	void Send(int pidevice, int pin, const std::vector<uint>& times, int repeat);
+	void Send(int pidevice, int pin, const std::vector<uint16>& times, int repeat);
+	void Send(int pidevice, int pin, const uint16* times, uint count, int repeat);
 };
 
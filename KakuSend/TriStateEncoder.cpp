@@ -0,0 +1,66 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#include "TriStateEncoder.h"
+
+// Constructor
+TriStateEncoder::TriStateEncoder()
+{
+}
+
+// Destructor
+TriStateEncoder::~TriStateEncoder()
+{
+}
+
+// Encodes 12 trits (0, 1 or F) to pulse durations
+std::string TriStateEncoder::Encode(std::string trits, std::vector<uint16>& timesout)
+{
+	timesout.clear();
+	if(trits.size() != Encoder::SYMBOLS)
+		return "Unable to encode tri-state code. A code has 12 trits.";
+
+	// The trits 0, 1 and F are the symbols 0, 1 and 2
+	std::vector<uint> symbols;
+	for(char c : trits)
+	{
+		if(c == '0')
+			symbols.push_back(0);
+		else if(c == '1')
+			symbols.push_back(1);
+		else if((c == 'F') || (c == 'f') || (c == '2'))
+			symbols.push_back(2);
+		else
+			return "Unable to encode tri-state code. Invalid trits.";
+	}
+
+	Encoder::Encode(symbols, timesout);
+	return std::string();
+}
+
+// Encodes the switch of a code wheel to pulse durations.
+// The house is 'A' to 'P' and the unit is 1 to 16.
+std::string TriStateEncoder::Encode(char house, uint unit, bool on, std::vector<uint16>& timesout)
+{
+	timesout.clear();
+	if((house >= 'a') && (house <= 'p'))
+		house = static_cast<char>(house - 'a' + 'A');
+	if((house < 'A') || (house > 'P'))
+		return "Unable to encode tri-state code. The house code must be A to P.";
+	if((unit < 1) || (unit > 16))
+		return "Unable to encode tri-state code. The unit must be 1 to 16.";
+
+	// House and unit are sent with the lowest bit first, a 1 bit as F.
+	// These are followed by 0 F F and the state.
+	uint housenumber = static_cast<uint>(house - 'A');
+	uint unitnumber = unit - 1;
+	std::string trits;
+	for(uint i = 0; i < 4; i++)
+		trits += ((housenumber >> i) & 1) ? 'F' : '0';
+	for(uint i = 0; i < 4; i++)
+		trits += ((unitnumber >> i) & 1) ? 'F' : '0';
+	trits += "0FF";
+	trits += on ? 'F' : '0';
+	return Encode(trits, timesout);
+}
@@ -0,0 +1,34 @@
+/*
+	Copyright (c) 2019 Pascal van der Heiden, www.codeimp.com.
+	This software is released under MIT license.
+*/
+#pragma once
+#include <vector>
+#include <string>
+#include "../KakuNu/Tools.h"
+#include "PulseCodeEncoder.h"
+
+/*
+	This encodes messages of the old KAKU protocol of switches with code wheels.
+	See PulseCodeDecoder for a description of the protocol.
+*/
+class TriStateEncoder
+{
+private:
+
+	// The pulses of the trits
+	typedef PulseCodeEncoder<TriStateSpec> Encoder;
+
+public:
+
+	// Constructor / destructor
+	TriStateEncoder();
+	virtual ~TriStateEncoder();
+
+	// Encodes 12 trits (0, 1 or F) to pulse durations
+	std::string Encode(std::string trits, std::vector<uint16>& timesout);
+
+	// Encodes the switch of a code wheel to pulse durations.
+	// The house is 'A' to 'P' and the unit is 1 to 16.
+	std::string Encode(char house, uint unit, bool on, std::vector<uint16>& timesout);
+};
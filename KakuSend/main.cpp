@@ -5,6 +5,7 @@
 #include <iostream>
 #include <errno.h>
 #include <string.h>
+#include <stdlib.h>
 #ifdef PIGPIO_IF2
 #include <pigpiod_if2.h>
 #else
@@ -12,6 +13,7 @@
 #endif
 #include "../KakuNu/MicroClock.h"
 #include "KakuEncoder.h"
+#include "TriStateEncoder.h"
 #include "RFTransmitter.h"
 
 // ccxopts raises some warnings (and rightfully so) about integer conversion
@@ -35,7 +37,13 @@ cxxopts::ParseResult ParseCommandLineOptions(int& argc, char**& argv)
 			.add_options()
 			("help", "Shows information about the command line options.")
 			("p", "BCM GPIO pin to transmit on", cxxopts::value<int>()->default_value("17"))
-			("r", "Number of times to transmit the message", cxxopts::value<int>()->default_value("4"));
+			("r", "Number of times to transmit the message", cxxopts::value<int>()->default_value("4"))
+			("a", "Address to make a self-learning message for, instead of giving the bitcode", cxxopts::value<uint>())
+			("u", "Unit for the self-learning message", cxxopts::value<uint>()->default_value("0"))
+			("g", "Make a group command for the self-learning message")
+			("s", "State for the self-learning message: on, off or a dim level 0-15", cxxopts::value<std::string>()->default_value("on"))
+			("t", "The bitcode is a tri-state code for an old switch with code wheels (12 trits of 0, 1 or F)")
+			("w", "Code wheels of an old switch to make a message for, for example A1 (house A-P, unit 1-16)", cxxopts::value<std::string>());
 		options.custom_help("bitcode [options...]");
 
 		// Parse the arguments with these options
@@ -43,11 +51,14 @@ cxxopts::ParseResult ParseCommandLineOptions(int& argc, char**& argv)
 
 		// If the user is just asking for help,
 		// output the available command line options...
-		if((argc < 2) || cmdargs.count("help"))
+		if(((argc < 2) && !cmdargs.count("a") && !cmdargs.count("w")) || cmdargs.count("help"))
 		{
 			std::cout << options.help() << std::endl;
 			std::cout << "Example:" << std::endl;
 			std::cout << "   kakusend 11010101101011100010110000011000 -r 4" << std::endl;
+			std::cout << "   kakusend -a 14199344 -u 8 -s off" << std::endl;
+			std::cout << "   kakusend -t 0F0F0000F0FF" << std::endl;
+			std::cout << "   kakusend -w B3 -s on" << std::endl;
 			exit(0);
 		}
 
@@ -64,6 +75,7 @@ cxxopts::ParseResult ParseCommandLineOptions(int& argc, char**& argv)
 int main(int argc, char* argv[])
 {
 	KakuEncoder encoder;
+	TriStateEncoder tristateencoder;
 	RFTransmitter transmitter;
 	int pi = 0;
 
@@ -93,10 +105,63 @@ int main(int argc, char* argv[])
 	// Start the clock
 	microclock.Start(pi);
 
-	// Encode the specified bits into time pulses
-	std::vector<uint> times;
-	std::string code = nargv[1];
-	std::string error = encoder.Encode(code, times);
+	// Encode the specified bits or fields into time pulses
+	std::vector<uint16> times;
+	std::string code;
+	std::string error;
+	if(cmdargs.count("a"))
+	{
+		KakuFields fields;
+		fields.address = cmdargs["a"].as<uint>();
+		fields.unit = cmdargs["u"].as<uint>();
+		fields.group = (cmdargs.count("g") > 0);
+		std::string state = cmdargs["s"].as<std::string>();
+		if(state == "on")
+			fields.state = KakuFields::State::On;
+		else if(state == "off")
+			fields.state = KakuFields::State::Off;
+		else
+		{
+			char* end = nullptr;
+			fields.state = KakuFields::State::Dim;
+			fields.dimlevel = static_cast<uint>(strtoul(state.c_str(), &end, 10));
+			if((state.size() == 0) || (*end != '\0'))
+				fields.dimlevel = 16;
+		}
+
+		error = encoder.Encode(fields, times);
+		KakuMessage msg;
+		msg.SetFields(fields);
+		code = msg.ToString();
+	}
+	else if(cmdargs.count("w"))
+	{
+		// The house letter is followed by the unit number
+		std::string wheels = cmdargs["w"].as<std::string>();
+		std::string state = cmdargs["s"].as<std::string>();
+		char* end = nullptr;
+		uint unit = (wheels.size() > 1) ? static_cast<uint>(strtoul(wheels.c_str() + 1, &end, 10)) : 0;
+		if((end == nullptr) || (*end != '\0'))
+			error = "Unable to encode tri-state code. Use a house letter and unit number, for example A1.";
+		else if((state != "on") && (state != "off"))
+			error = "Unable to encode tri-state code. The state must be on or off.";
+		else
+			error = tristateencoder.Encode(wheels[0], unit, (state == "on"), times);
+		code = wheels + " " + state;
+	}
+	else if(argc > 1)
+	{
+		code = nargv[1];
+		if(cmdargs.count("t"))
+			error = tristateencoder.Encode(code, times);
+		else
+			error = encoder.Encode(code, times);
+	}
+	else
+	{
+		error = "Specify a bitcode, an address or code wheels.";
+	}
+
 	if(error.size() > 0)
 	{
 		std::cout << error << std::endl;